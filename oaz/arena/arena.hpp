@@ -0,0 +1,362 @@
+#ifndef OAZ_ARENA_ARENA_HPP_
+#define OAZ_ARENA_ARENA_HPP_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+  #include <sys/mman.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "oaz/mutex/mutex.hpp"
+
+namespace oaz::arena {
+
+/* Slab allocator for objects that are released all at once, such as the
+ * nodes of a search tree. Memory is carved out of fixed-size, aligned slabs
+ * so that the arena owning any allocation can be recovered from its address.
+ * Each thread allocates from its own shard to avoid contention. Freed blocks
+ * are recycled through per-shard free lists, which a thread steals from the
+ * other shards when its own runs dry, so that blocks freed by one thread can
+ * be reused by all of them. Blocks too large for a size class are rounded up
+ * to a power of two and recycled through arena-wide lists. Reset releases
+ * everything in one go without running any destructor. */
+class Arena {
+ public:
+  static constexpr size_t SLAB_SIZE = 1 << 16;
+  static constexpr size_t HUGE_PAGE_SIZE = 1 << 21;
+  static constexpr size_t ALIGNMENT = 16;
+  static constexpr size_t N_SHARDS = 16;
+  static constexpr size_t N_SIZE_CLASSES = 256;
+  static constexpr size_t N_LARGE_CLASSES = 5;
+
+  explicit Arena(bool use_huge_pages = false)
+      : m_use_huge_pages(use_huge_pages), m_n_reserved_bytes(0) {}
+
+  ~Arena() { ReleaseRegions(); }
+  Arena(const Arena&) = delete;
+  Arena(Arena&&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  Arena& operator=(Arena&&) = delete;
+
+  static size_t GetMaxAllocationSize() { return SLAB_SIZE - HEADER_SIZE; }
+
+  void* Allocate(size_t size) {
+    size = RoundUp(size);
+    if (size > GetMaxAllocationSize()) {
+      throw std::length_error("Allocation does not fit in an arena slab");
+    }
+    size_t size_class = size / ALIGNMENT;
+    if (size_class >= N_SIZE_CLASSES) {
+      return AllocateLarge(size);
+    }
+    Shard& shard = GetShard();
+    shard.lock.Lock();
+    if (!shard.free_lists[size_class] && m_n_free_blocks[size_class] != 0) {
+      shard.lock.Unlock();
+      StealFreeBlocks(shard, size_class);
+      shard.lock.Lock();
+    }
+    void* pointer = nullptr;
+    if (shard.free_lists[size_class]) {
+      FreeBlock* block = shard.free_lists[size_class];
+      shard.free_lists[size_class] = block->next;
+      --m_n_free_blocks[size_class];
+      pointer = block;
+    } else {
+      try {
+        pointer = Carve(shard, size);
+      } catch (...) {
+        shard.lock.Unlock();
+        throw;
+      }
+    }
+    shard.n_allocated_bytes += size;
+    shard.lock.Unlock();
+    return pointer;
+  }
+
+  void Free(void* pointer, size_t size) {
+    size = RoundUp(size);
+    size_t size_class = size / ALIGNMENT;
+    if (size_class >= N_SIZE_CLASSES) {
+      FreeLarge(pointer, size);
+      return;
+    }
+    Shard& shard = GetShard();
+    shard.lock.Lock();
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = shard.free_lists[size_class];
+    shard.free_lists[size_class] = block;
+    ++m_n_free_blocks[size_class];
+    shard.n_allocated_bytes -= size;
+    shard.lock.Unlock();
+  }
+
+  /* Releases all allocations at once. Slabs are kept for reuse. Must not be
+   * called concurrently with Allocate or Free. */
+  void Reset() {
+    for (Shard& shard : m_shards) {
+      shard.cursor = nullptr;
+      shard.end = nullptr;
+      shard.free_lists.fill(nullptr);
+      shard.n_allocated_bytes = 0;
+    }
+    for (std::atomic<size_t>& n_free_blocks : m_n_free_blocks) {
+      n_free_blocks = 0;
+    }
+    m_lock.Lock();
+    m_large_free_lists.fill(nullptr);
+    m_free_slabs = m_slabs;
+    m_lock.Unlock();
+  }
+
+  /* Arena that owns pointer, which must have been returned by Allocate */
+  static Arena* GetArena(const void* pointer) {
+    auto address = reinterpret_cast<uintptr_t>(pointer);
+    return reinterpret_cast<SlabHeader*>(address & ~(SLAB_SIZE - 1))->arena;
+  }
+
+  /* Number of bytes currently handed out, rounded to the allocation grain */
+  size_t GetNAllocatedBytes() const {
+    int64_t n_allocated_bytes = 0;
+    for (const Shard& shard : m_shards) {
+      n_allocated_bytes += shard.n_allocated_bytes;
+    }
+    return n_allocated_bytes > 0 ? n_allocated_bytes : 0;
+  }
+
+  /* Number of bytes of slab memory obtained from the system */
+  size_t GetNReservedBytes() const { return m_n_reserved_bytes; }
+
+  bool UsesHugePages() const { return m_use_huge_pages; }
+
+ private:
+  struct SlabHeader {
+    Arena* arena;
+  };
+  static constexpr size_t HEADER_SIZE = 64;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct alignas(64) Shard {
+    oaz::mutex::SpinlockMutex lock;
+    char* cursor = nullptr;
+    char* end = nullptr;
+    int64_t n_allocated_bytes = 0;
+    std::array<FreeBlock*, N_SIZE_CLASSES> free_lists{};
+  };
+
+  struct Region {
+    void* pointer;
+    size_t size;
+    bool mapped;
+  };
+
+  static size_t RoundUp(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  /* Power of two class of a block too large for the size classes. The last
+   * class is capped at the largest allocation a slab can hold. */
+  static size_t GetLargeClass(size_t size) {
+    size_t large_class = 0;
+    for (size_t capacity = N_SIZE_CLASSES * ALIGNMENT; capacity < size;
+         capacity *= 2) {
+      ++large_class;
+    }
+    return large_class;
+  }
+
+  static size_t GetLargeClassSize(size_t large_class) {
+    size_t size = (N_SIZE_CLASSES * ALIGNMENT) << large_class;
+    return size < GetMaxAllocationSize() ? size : GetMaxAllocationSize();
+  }
+
+  Shard& GetShard() {
+    static std::atomic<size_t> n_threads(0);
+    static thread_local size_t thread_index = n_threads++;
+    return m_shards[thread_index % N_SHARDS];
+  }
+
+  /* Carves a fresh block out of the shard's slab. The shard must be locked. */
+  char* Carve(Shard& shard, size_t size) {
+    if (shard.cursor == nullptr || shard.cursor + size > shard.end) {
+      char* slab = AcquireSlab();
+      shard.cursor = slab + HEADER_SIZE;
+      shard.end = slab + SLAB_SIZE;
+    }
+    char* pointer = shard.cursor;
+    shard.cursor += size;
+    return pointer;
+  }
+
+  /* Moves the free blocks of a size class held by another shard into shard.
+   * Only one shard lock is held at a time so that threads stealing from each
+   * other cannot deadlock. */
+  void StealFreeBlocks(Shard& shard, size_t size_class) {
+    for (Shard& victim : m_shards) {
+      if (&victim == &shard) {
+        continue;
+      }
+      victim.lock.Lock();
+      FreeBlock* stolen = victim.free_lists[size_class];
+      victim.free_lists[size_class] = nullptr;
+      victim.lock.Unlock();
+      if (stolen == nullptr) {
+        continue;
+      }
+      FreeBlock* tail = stolen;
+      while (tail->next != nullptr) {
+        tail = tail->next;
+      }
+      shard.lock.Lock();
+      tail->next = shard.free_lists[size_class];
+      shard.free_lists[size_class] = stolen;
+      shard.lock.Unlock();
+      return;
+    }
+  }
+
+  void* AllocateLarge(size_t size) {
+    size_t large_class = GetLargeClass(size);
+    size = GetLargeClassSize(large_class);
+    m_lock.Lock();
+    FreeBlock* block = m_large_free_lists[large_class];
+    if (block) {
+      m_large_free_lists[large_class] = block->next;
+    }
+    m_lock.Unlock();
+    Shard& shard = GetShard();
+    shard.lock.Lock();
+    void* pointer = block;
+    if (pointer == nullptr) {
+      try {
+        pointer = Carve(shard, size);
+      } catch (...) {
+        shard.lock.Unlock();
+        throw;
+      }
+    }
+    shard.n_allocated_bytes += size;
+    shard.lock.Unlock();
+    return pointer;
+  }
+
+  void FreeLarge(void* pointer, size_t size) {
+    size_t large_class = GetLargeClass(size);
+    size = GetLargeClassSize(large_class);
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    m_lock.Lock();
+    block->next = m_large_free_lists[large_class];
+    m_large_free_lists[large_class] = block;
+    m_lock.Unlock();
+    Shard& shard = GetShard();
+    shard.lock.Lock();
+    shard.n_allocated_bytes -= size;
+    shard.lock.Unlock();
+  }
+
+  char* AcquireSlab() {
+    m_lock.Lock();
+    if (m_free_slabs.empty()) {
+      try {
+        ReserveSlabs();
+      } catch (...) {
+        m_lock.Unlock();
+        throw;
+      }
+    }
+    char* slab = m_free_slabs.back();
+    m_free_slabs.pop_back();
+    m_lock.Unlock();
+    return slab;
+  }
+
+  void ReserveSlabs() {
+    Region region = m_use_huge_pages ? MapHugePages() : AllocateSlab();
+    m_regions.push_back(region);
+    m_n_reserved_bytes += region.size;
+    char* begin = static_cast<char*>(region.pointer);
+    for (size_t offset = 0; offset != region.size; offset += SLAB_SIZE) {
+      char* slab = begin + offset;
+      reinterpret_cast<SlabHeader*>(slab)->arena = this;
+      m_slabs.push_back(slab);
+      m_free_slabs.push_back(slab);
+    }
+  }
+
+  static Region AllocateSlab() {
+    void* pointer = aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+    if (pointer == nullptr) {
+      throw std::bad_alloc();
+    }
+    return {pointer, SLAB_SIZE, false};
+  }
+
+  static Region MapHugePages() {
+#ifdef __linux__
+    // Over-map so that a huge page aligned region can be carved out
+    size_t size = 2 * HUGE_PAGE_SIZE;
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    auto address = reinterpret_cast<uintptr_t>(mapping);
+    uintptr_t aligned =
+        (address + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned != address) {
+      munmap(mapping, aligned - address);
+    }
+    size_t tail = address + size - (aligned + HUGE_PAGE_SIZE);
+    if (tail != 0) {
+      munmap(reinterpret_cast<void*>(aligned + HUGE_PAGE_SIZE), tail);
+    }
+    void* pointer = reinterpret_cast<void*>(aligned);
+    madvise(pointer, HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+    return {pointer, HUGE_PAGE_SIZE, true};
+#else
+    void* pointer = aligned_alloc(HUGE_PAGE_SIZE, HUGE_PAGE_SIZE);
+    if (pointer == nullptr) {
+      throw std::bad_alloc();
+    }
+    return {pointer, HUGE_PAGE_SIZE, false};
+#endif
+  }
+
+  void ReleaseRegions() {
+    for (const Region& region : m_regions) {
+#ifdef __linux__
+      if (region.mapped) {
+        munmap(region.pointer, region.size);
+        continue;
+      }
+#endif
+      free(region.pointer);
+    }
+    m_regions.clear();
+  }
+
+  bool m_use_huge_pages;
+  std::array<Shard, N_SHARDS> m_shards;
+  std::array<std::atomic<size_t>, N_SIZE_CLASSES> m_n_free_blocks{};
+
+  oaz::mutex::SpinlockMutex m_lock;
+  std::vector<Region> m_regions;
+  std::vector<char*> m_slabs;
+  std::vector<char*> m_free_slabs;
+  std::array<FreeBlock*, N_LARGE_CLASSES> m_large_free_lists{};
+  std::atomic<size_t> m_n_reserved_bytes;
+};
+}  // namespace oaz::arena
+#endif  // OAZ_ARENA_ARENA_HPP_
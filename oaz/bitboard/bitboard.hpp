@@ -32,7 +32,7 @@ class BitBoard {
     m_board &= BOARD_MASK;
   }
   constexpr void Unset(size_t i, size_t j) {
-    m_board &= (~1ULL << (i * NCOLS + j));
+    m_board &= ~(1ULL << (i * NCOLS + j));
   }
   constexpr size_t Sum() const { return std::bitset<N_BITS>(m_board).count(); }
   constexpr size_t RowSum(size_t i) const {
@@ -70,6 +70,15 @@ class BitBoard {
     return m_board == rhs.m_board;
   }
 
+  /* Mirror image of the board, with the columns in reverse order */
+  constexpr BitBoard MirrorColumns() const {
+    uint64_t board = 0ULL;
+    for (size_t j = 0; j != NCOLS; ++j) {
+      board |= ((m_board >> j) & COLUMN_MASK) << (NCOLS - 1 - j);
+    }
+    return BitBoard(board);
+  }
+
   constexpr bool IsContainedIn(const BitBoard& board) const {
     return ((*this) & board) == (*this);
   }
@@ -81,11 +90,19 @@ class BitBoard {
     uint64_t masked_board = m_board & mask_board.m_board;
     uint64_t filled_masked_board = m_board | ~mask_board.m_board;
     uint64_t lhs_masked_board = masked_board >> bit_position;
-    uint64_t rhs_masked_board = masked_board << (N_BITS - bit_position);
     uint64_t lhs_filled_masked_board = filled_masked_board >> bit_position;
-    uint64_t rhs_filled_masked_board = filled_masked_board
-                                       << (N_BITS - bit_position);
-    uint64_t lhs_lead_mask = (1LL << tocount_ll(lhs_filled_masked_board)) - 1;
+    // Shifting by N_BITS is undefined: nothing precedes the first square
+    uint64_t rhs_masked_board =
+        bit_position == 0 ? 0ULL : masked_board << (N_BITS - bit_position);
+    uint64_t rhs_filled_masked_board =
+        bit_position == 0 ? 0ULL
+                          : filled_masked_board << (N_BITS - bit_position);
+    uint64_t tocount_lhs_filled_masked_board =
+        tocount_ll(lhs_filled_masked_board);
+    uint64_t lhs_lead_mask =
+        tocount_lhs_filled_masked_board == N_BITS
+            ? ~0ULL
+            : (1ULL << tocount_lhs_filled_masked_board) - 1;
 
     uint64_t locount_rhs_filled_masked_board =
         locount_ll(rhs_filled_masked_board);
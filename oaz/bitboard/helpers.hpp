@@ -20,8 +20,13 @@ inline uint64_t popcount_ll(uint64_t bits) {
   return std::bitset<N_BITS>(bits).count();
 }
 
-inline uint64_t locount_ll(uint64_t bits) { return __builtin_clzll(~bits); }
+// The builtins are undefined for 0, hence the special case of all ones
+inline uint64_t locount_ll(uint64_t bits) {
+  return ~bits == 0 ? 64 : __builtin_clzll(~bits);
+}
 
-inline uint64_t tocount_ll(uint64_t bits) { return __builtin_ctzll(~bits); }
+inline uint64_t tocount_ll(uint64_t bits) {
+  return ~bits == 0 ? 64 : __builtin_ctzll(~bits);
+}
 }  // namespace oaz::bitboard
 #endif  // OAZ_BITBOARD_HELPERS_HPP_
@@ -1,6 +1,9 @@
 #ifndef OAZ_EVALUATOR_EVALUATOR_HPP_
 #define OAZ_EVALUATOR_EVALUATOR_HPP_
 
+#include <memory>
+#include <vector>
+
 #include "boost/multi_array.hpp"
 #include "oaz/games/game.hpp"
 #include "oaz/thread_pool/thread_pool.hpp"
@@ -26,6 +29,17 @@ class Evaluation {
 class Evaluator {
  public:
   virtual void RequestEvaluation(oaz::games::Game*, std::unique_ptr<Evaluation>*, oaz::thread_pool::Task*) = 0;
+  /* Requests the evaluations of several positions at once, element i of each
+   * vector belonging to the same request. By default, they are requested
+   * one at a time. */
+  virtual void RequestEvaluations(
+      const std::vector<oaz::games::Game*>& games,
+      const std::vector<std::unique_ptr<Evaluation>*>& evaluations,
+      const std::vector<oaz::thread_pool::Task*>& tasks) {
+    for (size_t i = 0; i != games.size(); ++i) {
+      RequestEvaluation(games[i], evaluations[i], tasks[i]);
+    }
+  }
 
   virtual ~Evaluator() {}
   Evaluator() = default;
@@ -18,6 +18,8 @@ void oaz::games::Bandits::PlayFromString(std::string moves) {
 
 void oaz::games::Bandits::PlayMove(size_t move) { m_board.set(move); }
 
+void oaz::games::Bandits::UndoMove(size_t move) { m_board.reset(move); }
+
 void oaz::games::Bandits::GetAvailableMoves(
     std::vector<size_t>* available_moves) const {
   available_moves->clear();
@@ -43,6 +45,10 @@ std::unique_ptr<oaz::games::Game> oaz::games::Bandits::Clone() const {
   return std::make_unique<Bandits>(*this);
 }
 
+void oaz::games::Bandits::CopyFrom(const Game& game) {
+  *this = static_cast<const Bandits&>(game);
+}
+
 bool oaz::games::Bandits::operator==(const Bandits& rhs) const {
   return m_board == rhs.m_board;
 }
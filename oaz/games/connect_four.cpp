@@ -49,6 +49,14 @@ void oaz::games::ConnectFour::PlayMove(size_t move) {
   MaybeEndGame(victory, player);
 }
 
+void oaz::games::ConnectFour::UndoMove(size_t move) {
+  size_t row = (m_player0_tokens | m_player1_tokens).ColumnSum(move) - 1;
+  m_player0_tokens.Unset(row, move);
+  m_player1_tokens.Unset(row, move);
+  // The game could not have been finished before its last move
+  m_status.reset();
+}
+
 void oaz::games::ConnectFour::MaybeEndGame(bool victory, size_t player) {
   if (victory) {
     SetWinner(player);
@@ -175,6 +183,19 @@ std::unique_ptr<oaz::games::Game> oaz::games::ConnectFour::Clone() const {
   return std::make_unique<ConnectFour>(*this);
 }
 
+void oaz::games::ConnectFour::CopyFrom(const Game& game) {
+  *this = static_cast<const ConnectFour&>(game);
+}
+
+bool oaz::games::ConnectFour::IsMirrorSymmetric() const {
+  return m_player0_tokens.MirrorColumns() == m_player0_tokens &&
+         m_player1_tokens.MirrorColumns() == m_player1_tokens;
+}
+
+size_t oaz::games::ConnectFour::GetMirrorMove(size_t move) const {
+  return N_COLUMNS - 1 - move;
+}
+
 bool oaz::games::ConnectFour::operator==(const ConnectFour& rhs) const {
   return m_player0_tokens == rhs.m_player0_tokens &&
          m_player1_tokens == rhs.m_player1_tokens && m_status == rhs.m_status;
@@ -14,7 +14,7 @@
 #include "oaz/games/generic_game_map.hpp"
 
 namespace oaz::games {
-class ConnectFour : public Game {
+class ConnectFour final : public Game {
  public:
   struct Class : public Game::Class {
     size_t GetMaxNumberOfMoves() const override { return N_COLUMNS; }
@@ -38,6 +38,7 @@ class ConnectFour : public Game {
 
   void PlayFromString(std::string moves) override;
   void PlayMove(size_t move) override;
+  void UndoMove(size_t move) override;
   size_t GetCurrentPlayer() const override;
   bool IsFinished() const override;
   void GetAvailableMoves(std::vector<size_t>* available_moves) const override;
@@ -47,6 +48,9 @@ class ConnectFour : public Game {
   void InitialiseFromState(float* input_board) override;
   void InitialiseFromCanonicalState(float* input_board) override;
   std::unique_ptr<Game> Clone() const override;
+  void CopyFrom(const Game&) override;
+  bool IsMirrorSymmetric() const override;
+  size_t GetMirrorMove(size_t move) const override;
 
   bool operator==(const ConnectFour&) const;
 
@@ -33,6 +33,9 @@ class Game {
 
   virtual void PlayFromString(std::string) = 0;
   virtual void PlayMove(size_t) = 0;
+  /* Reverts PlayMove(move), where move is the last move played. Allows a
+   * game to be walked back along a path without being cloned. */
+  virtual void UndoMove(size_t) = 0;
   virtual void GetAvailableMoves(std::vector<size_t>*) const = 0;
   virtual float GetScore() const = 0;
   virtual size_t GetCurrentPlayer() const = 0;
@@ -42,6 +45,14 @@ class Game {
   virtual void InitialiseFromState(float*) = 0;
   virtual void InitialiseFromCanonicalState(float*) = 0;
   virtual std::unique_ptr<Game> Clone() const = 0;
+  /* Overwrites this game with game, which must be of the same class, so
+   * that a game can be reset without being cloned again */
+  virtual void CopyFrom(const Game&) = 0;
+  /* Whether the position is its own mirror image, in which case playing a
+   * move or its mirror move leads to equivalent positions. Games without
+   * such a symmetry keep the defaults. */
+  virtual bool IsMirrorSymmetric() const { return false; }
+  virtual size_t GetMirrorMove(size_t move) const { return move; }
 
   virtual ~Game(){};
   Game() = default;
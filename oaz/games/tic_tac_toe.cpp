@@ -27,6 +27,15 @@ void oaz::games::TicTacToe::PlayMove(size_t move) {
   MaybeEndGame(victory, player);
 }
 
+void oaz::games::TicTacToe::UndoMove(size_t move) {
+  size_t row = move % SIDE_LENGTH;
+  size_t column = move / SIDE_LENGTH;
+  m_player0_tokens.Unset(row, column);
+  m_player1_tokens.Unset(row, column);
+  // The game could not have been finished before its last move
+  m_status.reset();
+}
+
 void oaz::games::TicTacToe::MaybeEndGame(bool victory, size_t player) {
   if (victory) {
     SetWinner(player);
@@ -147,6 +156,21 @@ std::unique_ptr<oaz::games::Game> oaz::games::TicTacToe::Clone() const {
   return std::make_unique<TicTacToe>(*this);
 }
 
+void oaz::games::TicTacToe::CopyFrom(const Game& game) {
+  *this = static_cast<const TicTacToe&>(game);
+}
+
+bool oaz::games::TicTacToe::IsMirrorSymmetric() const {
+  return m_player0_tokens.MirrorColumns() == m_player0_tokens &&
+         m_player1_tokens.MirrorColumns() == m_player1_tokens;
+}
+
+size_t oaz::games::TicTacToe::GetMirrorMove(size_t move) const {
+  size_t row = move % SIDE_LENGTH;
+  size_t column = move / SIDE_LENGTH;
+  return (SIDE_LENGTH - 1 - column) * SIDE_LENGTH + row;
+}
+
 void oaz::games::TicTacToe::WriteStateToTensorMemory(float* destination) const {
   boost::multi_array_ref<float, SIDE_LENGTH> tensor(
       destination, boost::extents[SIDE_LENGTH][SIDE_LENGTH][N_PLAYERS]);
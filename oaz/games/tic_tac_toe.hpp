@@ -13,7 +13,7 @@
 #include "oaz/games/generic_game_map.hpp"
 
 namespace oaz::games {
-class TicTacToe : public Game {
+class TicTacToe final : public Game {
  public:
   struct Class : public Game::Class {
     size_t GetMaxNumberOfMoves() const override { return N_SQUARES; }
@@ -37,6 +37,7 @@ class TicTacToe : public Game {
 
   void PlayFromString(std::string moves) override;
   void PlayMove(size_t move) override;
+  void UndoMove(size_t move) override;
   void GetAvailableMoves(std::vector<size_t>* available_moves) const override;
   size_t GetCurrentPlayer() const override;
   bool IsFinished() const override;
@@ -46,6 +47,9 @@ class TicTacToe : public Game {
   void InitialiseFromState(float* input_board) override;
   void InitialiseFromCanonicalState(float* input_board) override;
   std::unique_ptr<Game> Clone() const override;
+  void CopyFrom(const Game&) override;
+  bool IsMirrorSymmetric() const override;
+  size_t GetMirrorMove(size_t move) const override;
 
   bool operator==(const TicTacToe&);
 
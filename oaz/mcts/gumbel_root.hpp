@@ -0,0 +1,159 @@
+#ifndef OAZ_MCTS_GUMBEL_ROOT_HPP_
+#define OAZ_MCTS_GUMBEL_ROOT_HPP_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "oaz/mcts/search_node.hpp"
+#include "oaz/mcts/selection.hpp"
+
+namespace oaz::mcts {
+
+/* Root procedure of Gumbel AlphaZero (Danihelka et al., 2022), which keeps
+ * improving on the prior with as few as a dozen simulations. Once the root is
+ * expanded, the children with the highest log prior plus Gumbel noise are
+ * sampled, up to the number set by the selector. Simulations are then spread
+ * by sequential halving: in each of log2(n) phases, the children still in
+ * the running receive the same number of visits, after which only the better
+ * half by noise plus score goes on. The child to play is the best of the last
+ * ones standing. Progressive widening does not apply to the root. Not
+ * thread-safe: selections at the root are serialised by the search. */
+class GumbelRoot {
+ public:
+  GumbelRoot(const GumbelSelector& selector, SearchNode* root,
+             size_t n_simulations, std::mt19937* generator)
+      : m_selector(selector),
+        m_root(root),
+        m_n_visits(root->GetNChildren(), 0),
+        m_n_selections(0) {
+    size_t n_children = root->GetNChildren();
+    std::extreme_value_distribution<float> gumbel_distribution(0., 1.);
+    m_noise.reserve(n_children);
+    for (size_t i = 0; i != n_children; ++i) {
+      m_noise.push_back(gumbel_distribution(*generator));
+    }
+
+    // Sampling without replacement from the prior: the top children by log
+    // prior plus noise
+    std::vector<size_t> order(n_children);
+    for (size_t i = 0; i != n_children; ++i) {
+      order[i] = i;
+    }
+    size_t n_sampled =
+        std::min(n_children, std::max(selector.GetNSampledChildren(),
+                                      static_cast<size_t>(1)));
+    std::partial_sort(order.begin(), order.begin() + n_sampled, order.end(),
+                      [this](size_t lhs, size_t rhs) {
+                        return GetNoisyLogPrior(lhs) > GetNoisyLogPrior(rhs);
+                      });
+    m_sampled.assign(n_children, false);
+    for (size_t i = 0; i != n_sampled; ++i) {
+      m_sampled[order[i]] = true;
+    }
+    SetConsideredVisits(n_sampled, n_simulations);
+  }
+
+  /* Index of the child the next simulation goes through */
+  size_t SelectChild() {
+    size_t considered_visits = m_n_selections < m_considered_visits.size()
+                                   ? m_considered_visits[m_n_selections]
+                                   : GetMinNVisits();
+    ++m_n_selections;
+    size_t child_index = GetBestChild(considered_visits);
+    ++m_n_visits[child_index];
+    return child_index;
+  }
+
+  /* Index of the child to play */
+  size_t GetBestChild() const {
+    size_t max_n_visits = 0;
+    for (size_t i = 0; i != m_n_visits.size(); ++i) {
+      if (m_sampled[i]) {
+        max_n_visits = std::max(max_n_visits, m_n_visits[i]);
+      }
+    }
+    return GetBestChild(max_n_visits);
+  }
+
+ private:
+  float GetNoisyLogPrior(size_t index) const {
+    return m_noise[index] +
+           GumbelSelector::GetLogPrior(m_root->GetChild(index));
+  }
+
+  /* Best sampled child by noise plus score among those given n_visits visits
+   * so far. Visits given by the halving are counted rather than those of the
+   * tree, so that the selections in flight count as well. */
+  size_t GetBestChild(size_t n_visits) const {
+    thread_local std::vector<float> scores;
+    m_selector.GetScores(m_root, m_root->GetNChildren(), &scores);
+    size_t best_child_index = 0;
+    float best_score = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i != scores.size(); ++i) {
+      if (!m_sampled[i] || m_n_visits[i] != n_visits) {
+        continue;
+      }
+      float score = m_noise[i] + scores[i];
+      if (score > best_score) {
+        best_score = score;
+        best_child_index = i;
+      }
+    }
+    return best_child_index;
+  }
+
+  size_t GetMinNVisits() const {
+    size_t min_n_visits = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i != m_n_visits.size(); ++i) {
+      if (m_sampled[i]) {
+        min_n_visits = std::min(min_n_visits, m_n_visits[i]);
+      }
+    }
+    return min_n_visits;
+  }
+
+  /* The visit count a child must have to be selected by each simulation.
+   * Each phase gives every child still in the running the same number of
+   * visits, and halves their number. */
+  void SetConsideredVisits(size_t n_sampled, size_t n_simulations) {
+    m_considered_visits.clear();
+    m_considered_visits.reserve(n_simulations);
+    if (n_sampled <= 1) {
+      for (size_t i = 0; i != n_simulations; ++i) {
+        m_considered_visits.push_back(i);
+      }
+      return;
+    }
+    auto n_phases = static_cast<size_t>(
+        std::ceil(std::log2(static_cast<float>(n_sampled))));
+    std::vector<size_t> n_visits(n_sampled, 0);
+    size_t n_considered = n_sampled;
+    while (m_considered_visits.size() < n_simulations) {
+      size_t n_extra_visits =
+          std::max(n_simulations / (n_phases * n_considered), size_t(1));
+      for (size_t i = 0; i != n_extra_visits; ++i) {
+        for (size_t j = 0; j != n_considered; ++j) {
+          m_considered_visits.push_back(n_visits[j]);
+          ++n_visits[j];
+        }
+      }
+      n_considered = std::max(n_considered / 2, size_t(2));
+    }
+    m_considered_visits.resize(n_simulations);
+  }
+
+  GumbelSelector m_selector;
+  SearchNode* m_root;
+  std::vector<float> m_noise;
+  std::vector<bool> m_sampled;
+  std::vector<size_t> m_n_visits;
+  std::vector<size_t> m_considered_visits;
+  size_t m_n_selections;
+};
+}  // namespace oaz::mcts
+#endif  // OAZ_MCTS_GUMBEL_ROOT_HPP_
@@ -0,0 +1,105 @@
+#ifndef OAZ_MCTS_MULTI_SEARCH_HPP_
+#define OAZ_MCTS_MULTI_SEARCH_HPP_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "oaz/games/game.hpp"
+#include "oaz/mcts/search.hpp"
+#include "oaz/mcts/search_completion_queue.hpp"
+#include "oaz/thread_pool/thread_pool.hpp"
+
+namespace oaz::mcts {
+
+/* Searches many independent positions at once over one thread pool. The
+ * selections of all the trees are interleaved, so that an evaluator batching
+ * its requests fills its batches from many trees rather than waiting on its
+ * timeout for a single one. At most n_concurrent_searches searches run at a
+ * time, if positive; the next position is searched as soon as one is done.
+ * The constructor blocks until all the searches are done. Roots, if given,
+ * are reused as the roots of the searches of the corresponding games, like
+ * the root of a Search. */
+class MultiSearch {
+ public:
+  MultiSearch(
+      const std::vector<const oaz::games::Game*>& games,
+      const std::vector<PlayerSearchProperties>& player_search_properties,
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+      const SearchOptions& options, size_t n_concurrent_searches = 0,
+      const std::vector<std::shared_ptr<SearchNode>>& roots = {})
+      : m_searches(games.size()) {
+    if (!roots.empty() && roots.size() != games.size()) {
+      throw std::invalid_argument("Expected one root per game");
+    }
+    size_t n_searches = games.size();
+    if (n_concurrent_searches == 0 || n_concurrent_searches > n_searches) {
+      n_concurrent_searches = n_searches;
+    }
+
+    SearchCompletionQueue queue;
+    auto launch = [&](size_t index) {
+      m_searches[index] = Search::Launch(
+          *games[index], player_search_properties, thread_pool, options,
+          roots.empty() ? nullptr : roots[index],
+          [&queue, index] { queue.Push(index); });
+    };
+    size_t n_launched = 0;
+    size_t n_done = 0;
+    try {
+      while (n_launched != n_concurrent_searches) {
+        launch(n_launched);
+        ++n_launched;
+      }
+      while (n_done != n_searches) {
+        queue.Pop();
+        ++n_done;
+        if (n_launched != n_searches) {
+          launch(n_launched);
+          ++n_launched;
+        }
+      }
+    } catch (...) {
+      // The searches already launched push to the queue until they are done
+      for (size_t i = 0; i != n_launched; ++i) {
+        m_searches[i]->Stop();
+      }
+      for (; n_done != n_launched; ++n_done) {
+        queue.Pop();
+      }
+      throw;
+    }
+  }
+
+  size_t GetNSearches() const { return m_searches.size(); }
+  Search& GetSearch(size_t index) { return *m_searches[index]; }
+  std::shared_ptr<SearchNode> GetTreeRoot(size_t index) {
+    return m_searches[index]->GetTreeRoot();
+  }
+
+  /* Visit counts of the children of the root of search index, indexed by
+   * move. Moves without a child are left at 0, and the visits of a folded
+   * child are split with its mirror move. */
+  std::vector<size_t> GetVisits(size_t index, size_t n_moves) {
+    std::vector<size_t> n_visits(n_moves, 0);
+    std::shared_ptr<SearchNode> root = GetTreeRoot(index);
+    for (size_t i = 0; i != root->GetNChildren(); ++i) {
+      SearchNode* child = root->GetChild(i);
+      n_visits[child->GetMove()] = child->GetNVisits();
+    }
+    for (const auto& [move, mirror_move] :
+         m_searches[index]->GetFoldedMoves()) {
+      n_visits[mirror_move] = n_visits[move] / 2;
+      n_visits[move] -= n_visits[mirror_move];
+    }
+    return n_visits;
+  }
+
+ private:
+  std::vector<std::shared_ptr<Search>> m_searches;
+};
+}  // namespace oaz::mcts
+#endif  // OAZ_MCTS_MULTI_SEARCH_HPP_
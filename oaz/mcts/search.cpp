@@ -3,10 +3,14 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <cmath>
 #include <exception>
 #include <iostream>
 #include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
 #include <utility>
 #include <vector>
 
@@ -37,8 +41,10 @@ oaz::mcts::Search::SelectionTask::SelectionTask()
     : m_index(0), m_search(nullptr) {}
 
 void oaz::mcts::Search::SelectionTask::operator()() {
-  m_search->SelectNode(m_index);
-  m_search->HandleFinishedTask();
+  // The task may be reassigned once SelectNode returns
+  Search* search = m_search;
+  search->SelectAndRequestEvaluation(m_index);
+  search->HandleFinishedTask();
 }
 
 oaz::mcts::Search::ExpansionAndBackpropagationTask::
@@ -52,51 +58,172 @@ oaz::mcts::Search::ExpansionAndBackpropagationTask::
     : m_index(0), m_search(nullptr) {}
 
 void oaz::mcts::Search::ExpansionAndBackpropagationTask::operator()() {
-  m_search->ExpandAndBackpropagateNode(m_index);
-  m_search->HandleFinishedTask();
+  // The task may be reassigned once ExpandAndBackpropagateNode returns
+  Search* search = m_search;
+  search->ExpandAndBackpropagateNode(m_index);
+  search->HandleFinishedTask();
 }
 
-void oaz::mcts::Search::SelectNode(size_t index) {
-  oaz::mcts::SearchNode* node = GetNode(index);
-  oaz::games::Game* game = GetGame(index);
+oaz::mcts::Search::GroupSelectionTask::GroupSelectionTask(
+    oaz::mcts::Search* search, size_t group)
+    : m_search(search), m_group(group) {
+  m_search->HandleCreatedTask();
+}
 
-  size_t current_player = game->GetCurrentPlayer();
-
-  while (true) {
-    node->Lock();
-    if (!node->IsLeaf()) {
-      node->IncrementNVisits();
-      node->Unlock();
-      size_t child_index =
-	(*(m_player_search_properties[current_player].GetSelector()))(node);
-      node = node->GetChild(child_index);
-      game->PlayMove(node->GetMove());
-      SetNode(index, node);
-
-    } else if (node->IsBlockedForEvaluation()) {
-      Pause(index);
-      node->Unlock();
-      break;
-    } else {
-      node->IncrementNVisits();
-      if (!game->IsFinished()) {
-        node->BlockForEvaluation();
-      }
-      node->Unlock();
-      m_n_evaluation_requests++;
+oaz::mcts::Search::GroupSelectionTask::GroupSelectionTask()
+    : m_search(nullptr), m_group(0) {}
+
+void oaz::mcts::Search::GroupSelectionTask::operator()() {
+  // The task may be reassigned once SelectGroup returns
+  Search* search = m_search;
+  search->SelectGroup(m_group);
+  search->HandleFinishedTask();
+}
+
+void oaz::mcts::Search::SelectAndRequestEvaluation(size_t index) {
+  SelectionOutcome outcome = SelectNode(index);
+  if (outcome == SelectionOutcome::EVALUATION) {
+    RequestEvaluations(&index, 1);
+  } else if (outcome == SelectionOutcome::DONE && IsGrouped()) {
+    FinishGroupLeaf(index);
+  }
+}
 
+oaz::mcts::Search::SelectionOutcome oaz::mcts::Search::SelectNode(
+    size_t index) {
+  return (this->*m_descent)(index);
+}
+
+void oaz::mcts::Search::RequestEvaluations(const size_t* indices,
+                                           size_t n_indices) {
+  static thread_local std::vector<oaz::games::Game*> games;
+  static thread_local std::vector<std::unique_ptr<oaz::evaluator::Evaluation>*>
+      evaluations;
+  static thread_local std::vector<oaz::thread_pool::Task*> tasks;
+  static thread_local std::vector<size_t> players;
+  // Read up front: once handed to the evaluator, a selection may start over
+  players.clear();
+  for (size_t i = 0; i != n_indices; ++i) {
+    players.push_back(GetEvaluatorIndex(indices[i]));
+  }
+  // Leaves are handed to the evaluator of their player in one call
+  for (size_t player = 0; player != m_player_search_properties.size();
+       ++player) {
+    games.clear();
+    evaluations.clear();
+    tasks.clear();
+    for (size_t i = 0; i != n_indices; ++i) {
+      if (players[i] != player) {
+        continue;
+      }
+      size_t index = indices[i];
       m_expansion_and_backpropagation_tasks[index] =
           ExpansionAndBackpropagationTask(this, index);
+      games.push_back(GetGame(index));
+      evaluations.push_back(GetEvaluation(index));
+      tasks.push_back(&m_expansion_and_backpropagation_tasks[index]);
+    }
+    if (games.empty()) {
+      continue;
+    }
+    m_n_evaluation_requests += games.size();
+    m_player_search_properties[player].GetEvaluator()->RequestEvaluations(
+        games, evaluations, tasks);
+  }
+}
+
+size_t oaz::mcts::Search::GetEvaluatorIndex(size_t index) const {
+  return m_evaluator_indices[index];
+}
+
+bool oaz::mcts::Search::IsGrouped() const {
+  return m_n_leaves_per_task > 1;
+}
 
-      m_player_search_properties[current_player].GetEvaluator()->RequestEvaluation(
-          game, GetEvaluation(index), &m_expansion_and_backpropagation_tasks[index]);
+void oaz::mcts::Search::SelectGroup(size_t group) {
+  static thread_local std::vector<size_t> leaves;
+  leaves.clear();
+  std::atomic<size_t>& n_pending_leaves = m_n_pending_group_leaves[group];
+  // The pass holds one count, so that the group is not selected again
+  // before the pass is over
+  n_pending_leaves = 1;
+  size_t n_selected_leaves = 0;
+  size_t end = std::min((group + 1) * m_n_leaves_per_task, GetBatchSize());
+  for (size_t index = group * m_n_leaves_per_task; index != end; ++index) {
+    if (!ReserveSelection()) {
       break;
     }
+    ++n_pending_leaves;
+    ++n_selected_leaves;
+    // Virtual losses steer the selections of the pass to distinct leaves;
+    // those reaching a leaf that is already selected are paused
+    SelectionOutcome outcome = SelectNode(index);
+    if (outcome == SelectionOutcome::EVALUATION) {
+      leaves.push_back(index);
+    } else if (outcome == SelectionOutcome::DONE) {
+      --n_pending_leaves;
+    }
+  }
+  RequestEvaluations(leaves.data(), leaves.size());
+  if (--n_pending_leaves == 0 && n_selected_leaves != 0) {
+    MaybeSelectGroup(group);
+  }
+}
+
+void oaz::mcts::Search::FinishGroupLeaf(size_t index) {
+  size_t group = index / m_n_leaves_per_task;
+  if (--m_n_pending_group_leaves[group] == 0) {
+    MaybeSelectGroup(group);
   }
 }
 
+void oaz::mcts::Search::MaybeSelectGroup(size_t group) {
+  // The next pass finds out whether iterations are left
+  m_group_selection_tasks[group] = GroupSelectionTask(this, group);
+  m_thread_pool->enqueue(&m_group_selection_tasks[group]);
+}
+
+void oaz::mcts::Search::AddVirtualLoss(oaz::mcts::SearchNode* node) const {
+  // The root is left out, as backpropagation does not reach it
+  if (m_virtual_loss != 0. && !node->IsRoot()) {
+    node->AddValue(-m_virtual_loss);
+  }
+}
+
+size_t oaz::mcts::Search::GetNStatisticsShards() const {
+  // One shard per worker of the pool, plus one for the other threads
+  return m_thread_pool->GetNThreads() + 1;
+}
+
+size_t oaz::mcts::Search::GetNSelectableChildren(
+    oaz::mcts::SearchNode* node) const {
+  size_t n_children = node->GetNMoves();
+  if (m_widening_constant <= 0.) {
+    return n_children;
+  }
+  auto width = static_cast<size_t>(std::ceil(
+      m_widening_constant *
+      std::pow(static_cast<float>(node->GetNVisits()), m_widening_exponent)));
+  return std::min(std::max(width, size_t(1)), n_children);
+}
+
+size_t oaz::mcts::Search::SelectGumbelRootChild() {
+  m_gumbel_lock.Lock();
+  if (!m_gumbel_root) {
+    // The children of the root are sampled once they are known
+    m_gumbel_root = std::make_unique<GumbelRoot>(
+        *m_gumbel_selector, m_root.get(), GetNIterations(), &m_generator);
+  }
+  size_t child_index = m_gumbel_root->SelectChild();
+  m_gumbel_lock.Unlock();
+  return child_index;
+}
+
+/* Must be called with the node of the selection locked */
 void oaz::mcts::Search::Pause(size_t index) {
-  m_paused_nodes[index] = GetNode(index);
+  SearchNode* node = GetNode(index);
+  m_next_waiters[index] = node->GetFirstWaiter();
+  node->SetFirstWaiter(index + 1);
 }
 
 void oaz::mcts::Search::AddDirichletNoise(
@@ -128,35 +255,171 @@ void oaz::mcts::Search::ExpandNode(oaz::mcts::SearchNode* node,
   game->GetAvailableMoves(&available_moves);
   size_t player = game->GetCurrentPlayer();
 
+  std::vector<std::pair<float, size_t>> children;
+  children.reserve(available_moves.size());
+  bool fold = m_fold_symmetries && node == m_root.get() &&
+              game->IsMirrorSymmetric();
   for (auto move : available_moves) {
     float prior = evaluation->GetPolicy(move);
+    if (fold) {
+      // The child of the lower of two mirror moves stands for both
+      size_t mirror_move = game->GetMirrorMove(move);
+      if (mirror_move < move) {
+        continue;
+      }
+      if (mirror_move != move) {
+        prior += evaluation->GetPolicy(mirror_move);
+      }
+    }
+    children.emplace_back(prior, move);
+  }
+  if (m_widening_constant > 0.) {
+    // Widening reveals the children in this order: they are only built once
+    // revealed
+    std::stable_sort(children.begin(), children.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                       return lhs.first > rhs.first;
+                     });
+    node->SetPendingChildren(children, player);
+    BuildChildren(node, game, GetNSelectableChildren(node));
+    return;
+  }
+
+  node->ReserveChildren(children.size());
+  for (const auto& [prior, move] : children) {
     node->AddChild(move, player, prior);
   }
+  AddNodes(children.size());
+  SetUpChildren(node, game, 0, children.size());
 }
 
-void oaz::mcts::Search::Unpause(oaz::mcts::SearchNode* node) {
-  for (size_t index = 0; index != GetBatchSize(); ++index) {
-    if (m_paused_nodes[index] == node) {
-      m_selection_tasks[index] = SelectionTask(this, index);
-      m_thread_pool->enqueue(&m_selection_tasks[index]);
-      m_paused_nodes[index] = nullptr;
+void oaz::mcts::Search::BuildChildren(oaz::mcts::SearchNode* node,
+                                      oaz::games::Game* game, size_t n) {
+  size_t n_children = node->GetNChildren();
+  if (n <= n_children) {
+    return;
+  }
+  node->BuildPendingChildren(n);
+  AddNodes(n - n_children);
+  SetUpChildren(node, game, n_children, n);
+  node->PublishChildren(n);
+}
+
+void oaz::mcts::Search::SetUpChildren(oaz::mcts::SearchNode* node,
+                                      oaz::games::Game* game, size_t begin,
+                                      size_t end) {
+  // The children are not yet visible to other threads, so that they can be
+  // sharded here
+  size_t depth = 0;
+  for (SearchNode* ancestor = node;
+       !ancestor->IsRoot() && depth < m_n_sharded_levels;
+       ancestor = ancestor->GetParent()) {
+    ++depth;
+  }
+  if (depth + 1 < m_n_sharded_levels) {
+    for (size_t i = begin; i != end; ++i) {
+      node->GetChild(i)->ShardStatistics(GetNStatisticsShards());
     }
   }
+
+  if (m_transpositions) {
+    AddTranspositions(node, game, begin, end);
+  }
+}
+
+void oaz::mcts::Search::AddTranspositions(oaz::mcts::SearchNode* node,
+                                          oaz::games::Game* game,
+                                          size_t begin, size_t end) {
+  for (size_t i = begin; i != end; ++i) {
+    SearchNode* child = node->GetChild(i);
+    game->PlayMove(child->GetMove());
+    size_t target = 0;
+    m_transpositions_lock.Lock();
+    if (m_transpositions->Get(*game, &target)) {
+      child->SetAliasTarget(reinterpret_cast<SearchNode*>(target));
+    } else {
+      m_transpositions->Insert(*game, reinterpret_cast<uintptr_t>(child));
+    }
+    m_transpositions_lock.Unlock();
+    game->UndoMove(child->GetMove());
+  }
+}
+
+/* Must be called with the node locked */
+void oaz::mcts::Search::Unpause(oaz::mcts::SearchNode* node) {
+  size_t waiter = node->GetFirstWaiter();
+  node->SetFirstWaiter(0);
+  while (waiter != 0) {
+    size_t index = waiter - 1;
+    // Read first: once enqueued, the selection may pause again
+    waiter = m_next_waiters[index];
+    m_selection_tasks[index] = SelectionTask(this, index);
+    m_thread_pool->enqueue(&m_selection_tasks[index]);
+  }
 }
 
 size_t oaz::mcts::Search::GetNSelections() const { return m_n_selections; }
 
 size_t oaz::mcts::Search::GetNIterations() const { return m_n_iterations; }
 
-void oaz::mcts::Search::MaybeSelect(size_t index) {
+bool oaz::mcts::Search::ShouldStop() const {
+  return m_cancelled || (m_stop_token && m_stop_token->IsStopped()) ||
+         (m_time_budget > 0. && std::chrono::steady_clock::now() >= m_deadline);
+}
+
+/* Must be called with the selection lock held */
+bool oaz::mcts::Search::IsDecided() const {
+  if (m_use_solver && m_root->IsProven()) {
+    return true;
+  }
+  size_t n_remaining_iterations = GetNIterations() - GetNSelections();
+  // Cheap test first: no child can lead by more than the root visits
+  if (!m_stop_when_decided || n_remaining_iterations >= m_root->GetNVisits() ||
+      !m_root->IsExpanded()) {
+    return false;
+  }
+  // Visits of the selections in flight are already counted
+  size_t first = 0;
+  size_t second = 0;
+  for (size_t i = 0; i != m_root->GetNChildren(); ++i) {
+    size_t n_visits = m_root->GetChild(i)->GetNVisits();
+    if (n_visits > first) {
+      second = first;
+      first = n_visits;
+    } else if (n_visits > second) {
+      second = n_visits;
+    }
+  }
+  return first > second + n_remaining_iterations;
+}
+
+bool oaz::mcts::Search::ReserveSelection() {
+  // The tree is pruned once the selections in flight are completed
+  if (m_pruning_requested) {
+    return false;
+  }
   m_selection_lock.Lock();
   if (GetNSelections() < GetNIterations()) {
+    // The search is done once the selections in flight are completed
+    if (IsDecided()) {
+      m_n_saved_iterations = GetNIterations() - GetNSelections();
+      m_n_iterations = GetNSelections();
+    } else if (ShouldStop()) {
+      m_n_iterations = GetNSelections();
+    }
+  }
+  bool reserved = GetNSelections() < GetNIterations();
+  if (reserved) {
     ++m_n_selections;
-    m_selection_lock.Unlock();
+  }
+  m_selection_lock.Unlock();
+  return reserved;
+}
+
+void oaz::mcts::Search::MaybeSelect(size_t index) {
+  if (ReserveSelection()) {
     m_selection_tasks[index] = SelectionTask(this, index);
     m_thread_pool->enqueue(&m_selection_tasks[index]);
-  } else {
-    m_selection_lock.Unlock();
   }
 }
 
@@ -177,23 +440,113 @@ void oaz::mcts::Search::ExpandAndBackpropagateNode(size_t index) {
   oaz::mcts::SearchNode* node = GetNode(index);
   oaz::games::Game* game = GetGame(index);
 
-  if (!game->IsFinished()) {
-    node->Lock();
-    ExpandNode(node, game, evaluation);
-    node->UnblockForEvaluation();
-    Unpause(node);
-    node->Unlock();
+  node->Lock();
+  ExpandNode(node, game, evaluation);
+  node->SetExpanded();
+  node->UnblockForEvaluation();
+  Unpause(node);
+  node->Unlock();
+
+  CompleteIteration(index, value);
+  if (IsGrouped()) {
+    FinishGroupLeaf(index);
+  } else {
+    MaybeSelect(index);
   }
+}
 
-  BackpropagateNode(node, value);
+void oaz::mcts::Search::CompleteIteration(size_t index, float value) {
+  BackpropagateNode(m_paths[index], value);
+  PropagateProvenValues(m_paths[index]);
+  RewindGame(index);
   SetNode(index, m_root.get());
   IncrementNCompletions();
-  ResetGame(index);
-  MaybeSelect(index);
+}
+
+void oaz::mcts::Search::SetTerminalProvenValue(oaz::mcts::SearchNode* node,
+                                                float value) const {
+  if (!m_use_solver) {
+    return;
+  }
+  // The value is from the point of view of the player to move, while proven
+  // values are from the point of view of the player who moved
+  if (value < 0.5F) {  // NOLINT
+    node->SetProvenValue(ProvenValue::WIN);
+  } else if (value > 0.5F) {  // NOLINT
+    node->SetProvenValue(ProvenValue::LOSS);
+  } else {
+    node->SetProvenValue(ProvenValue::DRAW);
+  }
+}
+
+void oaz::mcts::Search::PropagateProvenValues(
+    const std::vector<oaz::mcts::SearchNode*>& path) const {
+  if (!m_use_solver) {
+    return;
+  }
+  // Proofs only change when a node on the path is proven, so propagation
+  // stops at the first node that cannot be proven
+  for (size_t i = path.size(); i-- != 0;) {
+    if (!path[i]->IsAlias() && !Prove(path[i])) {
+      return;
+    }
+  }
+}
+
+bool oaz::mcts::Search::Prove(oaz::mcts::SearchNode* node) {
+  if (node->IsProven()) {
+    return true;
+  }
+  if (!node->IsExpanded() || node->IsLeaf()) {
+    return false;
+  }
+  // Proven values of the children are from the point of view of the player
+  // to move at node
+  // Children that are not built yet are not proven
+  bool all_proven = node->GetNChildren() == node->GetNMoves();
+  bool has_draw = false;
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    ProvenValue value = node->GetChild(i)->GetProvenValue();
+    if (value == ProvenValue::WIN) {
+      node->SetProvenValue(ProvenValue::LOSS);
+      return true;
+    }
+    all_proven = all_proven && value != ProvenValue::UNKNOWN;
+    has_draw = has_draw || value == ProvenValue::DRAW;
+  }
+  if (!all_proven) {
+    return false;
+  }
+  node->SetProvenValue(has_draw ? ProvenValue::DRAW : ProvenValue::WIN);
+  return true;
+}
+
+float oaz::mcts::Search::GetTerminalValue(const oaz::games::Game& game) {
+  // From the point of view of the player to move, as evaluations are
+  float score = game.GetScore();
+  float value = game.GetCurrentPlayer() == 0 ? score : -score;
+  return (value + 1.0F) / 2.0F;  // NOLINT
 }
 
 void oaz::mcts::Search::ResetGame(size_t index) {
-  m_games[index] = std::move(m_game->Clone());
+  // A game of the same class is overwritten rather than cloned again
+  if (m_games[index] && typeid(*m_games[index]) == typeid(*m_game)) {
+    m_games[index]->CopyFrom(*m_game);
+  } else {
+    m_games[index] = m_game->Clone();
+  }
+}
+
+void oaz::mcts::Search::RewindGame(size_t index) {
+  oaz::games::Game* game = GetGame(index);
+  std::vector<SearchNode*>& path = m_paths[index];
+  for (size_t i = path.size() - 1; i != 0; --i) {
+    // The target of an alias is reached without playing a move
+    if (!path[i - 1]->IsAlias()) {
+      game->UndoMove(path[i]->GetMove());
+    }
+  }
+  path.resize(1);
 }
 
 bool oaz::mcts::Search::Done() const {
@@ -205,13 +558,12 @@ void oaz::mcts::Search::IncrementNCompletions() { ++m_n_completions; }
 size_t oaz::mcts::Search::GetNCompletions() const { return m_n_completions; }
 
 void oaz::mcts::Search::Initialise() {
-  std::random_device seeder;
-  m_generator.seed(seeder());
-
   for (size_t index = 0; index != GetBatchSize(); ++index) {
     ResetGame(index);
     m_nodes[index] = m_root.get();
-    m_paused_nodes[index] = nullptr;
+    m_paths[index].reserve(PATH_CAPACITY);
+    m_paths[index].assign(1, m_root.get());
+    m_next_waiters[index] = 0;
   }
 }
 
@@ -220,27 +572,8 @@ oaz::mcts::Search::Search(
     const std::vector<PlayerSearchProperties>& player_search_properties,
     std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
     size_t batch_size, size_t n_iterations)
-    : m_root(std::make_shared<oaz::mcts::SearchNode>()),
-      m_game(std::move(game.Clone())),
-      m_batch_size(batch_size),
-      m_n_iterations(n_iterations),
-      m_n_selections(0),
-      m_n_completions(0),
-      m_n_evaluation_requests(0),
-      m_n_active_tasks(0),
-      m_nodes(batch_size),
-      m_paused_nodes(batch_size),
-      m_games(batch_size),
-      m_evaluations(boost::extents[batch_size]),
-      m_noise_epsilon(0.),
-      m_noise_alpha(1.),
-      m_thread_pool(std::move(thread_pool)),
-      m_selection_tasks(boost::extents[batch_size]),
-      m_expansion_and_backpropagation_tasks(boost::extents[batch_size]),
-      m_player_search_properties(player_search_properties) {
-  Initialise();
-  PerformSearch();
-}
+    : Search(game, player_search_properties, std::move(thread_pool),
+             batch_size, n_iterations, 0., 1.) {}
 
 oaz::mcts::Search::Search(
     const oaz::games::Game& game,
@@ -248,36 +581,227 @@ oaz::mcts::Search::Search(
     std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
     size_t batch_size, size_t n_iterations, float noise_epsilon,
     float noise_alpha)
-    : m_root(std::make_shared<oaz::mcts::SearchNode>()),
+    : Search(game, player_search_properties, std::move(thread_pool),
+             batch_size, n_iterations, noise_epsilon, noise_alpha, nullptr) {}
+
+oaz::mcts::Search::Search(
+    const oaz::games::Game& game,
+    const std::vector<PlayerSearchProperties>& player_search_properties,
+    std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+    size_t batch_size, size_t n_iterations, float noise_epsilon,
+    float noise_alpha, std::shared_ptr<oaz::mcts::SearchNode> root)
+    : Search(game, player_search_properties, std::move(thread_pool),
+             [&] {
+               SearchOptions options;
+               options.batch_size = batch_size;
+               options.n_iterations = n_iterations;
+               options.noise_epsilon = noise_epsilon;
+               options.noise_alpha = noise_alpha;
+               return options;
+             }(),
+             std::move(root)) {}
+
+oaz::mcts::Search::Search(
+    const oaz::games::Game& game,
+    const std::vector<PlayerSearchProperties>& player_search_properties,
+    std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+    const SearchOptions& options, std::shared_ptr<oaz::mcts::SearchNode> root)
+    : Search(game, player_search_properties, std::move(thread_pool), options,
+             std::move(root), nullptr,
+             &Search::Descend<oaz::games::Game, Selector>) {
+  Start();
+  Wait();
+}
+
+std::shared_ptr<oaz::mcts::Search> oaz::mcts::Search::Launch(
+    const oaz::games::Game& game,
+    const std::vector<PlayerSearchProperties>& player_search_properties,
+    std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+    const SearchOptions& options, std::shared_ptr<oaz::mcts::SearchNode> root,
+    std::function<void()> callback) {
+  std::shared_ptr<Search> search(
+      new Search(game, player_search_properties, std::move(thread_pool),
+                 options, std::move(root), std::move(callback),
+                 &Search::Descend<oaz::games::Game, Selector>));
+  search->Start();
+  return search;
+}
+
+oaz::mcts::Search::Search(
+    const oaz::games::Game& game,
+    const std::vector<PlayerSearchProperties>& player_search_properties,
+    std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+    const SearchOptions& options, std::shared_ptr<oaz::mcts::SearchNode> root,
+    std::function<void()> callback, Descent descent)
+    : m_root(root ? std::move(root)
+                  : oaz::mcts::SearchNode::CreateRoot(
+                        std::make_shared<oaz::arena::Arena>())),
       m_game(std::move(game.Clone())),
-      m_batch_size(batch_size),
-      m_n_iterations(n_iterations),
+      m_batch_size(options.batch_size),
+      m_n_iterations(0),
       m_n_selections(0),
       m_n_completions(0),
       m_n_evaluation_requests(0),
       m_n_active_tasks(0),
-      m_nodes(batch_size),
-      m_paused_nodes(batch_size),
-      m_games(batch_size),
-      m_evaluations(boost::extents[batch_size]),
-      m_noise_epsilon(noise_epsilon),
-      m_noise_alpha(noise_alpha),
+      m_nodes(options.batch_size),
+      m_paths(options.batch_size),
+      m_next_waiters(options.batch_size),
+      m_games(options.batch_size),
+      m_evaluations(boost::extents[options.batch_size]),
+      m_noise_epsilon(options.noise_epsilon),
+      m_noise_alpha(options.noise_alpha),
+      m_virtual_loss(options.virtual_loss),
+      m_n_sharded_levels(options.n_sharded_levels),
+      m_time_budget(options.time_budget),
+      m_stop_token(options.stop_token),
+      m_use_solver(options.use_solver),
+      m_stop_when_decided(options.stop_when_decided),
+      m_widening_constant(options.widening_constant),
+      m_widening_exponent(options.widening_exponent),
+      m_n_saved_iterations(0),
+      m_reclaimer(options.reclaimer),
+      m_max_n_nodes(options.max_n_nodes),
+      m_node_budget(options.node_budget),
+      m_n_nodes(0),
+      m_pruning_requested(false),
+      m_n_prunings(0),
+      m_fold_symmetries(options.fold_symmetries),
+      m_done(false),
+      m_callback(std::move(callback)),
+      m_cancelled(false),
       m_thread_pool(std::move(thread_pool)),
-      m_selection_tasks(boost::extents[batch_size]),
-      m_expansion_and_backpropagation_tasks(boost::extents[batch_size]),
-      m_player_search_properties(player_search_properties) {
+      m_selection_tasks(boost::extents[options.batch_size]),
+      m_evaluator_indices(options.batch_size),
+      m_n_leaves_per_task(std::max(options.n_leaves_per_task, size_t(1))),
+      m_n_pending_group_leaves(new std::atomic<size_t>[
+          (options.batch_size + m_n_leaves_per_task - 1) /
+          m_n_leaves_per_task]),
+      m_group_selection_tasks(
+          boost::extents[(options.batch_size + m_n_leaves_per_task - 1) /
+                         m_n_leaves_per_task]),
+      m_expansion_and_backpropagation_tasks(
+          boost::extents[options.batch_size]),
+      m_player_search_properties(player_search_properties),
+      m_descent(descent),
+      m_gumbel_selector(dynamic_cast<GumbelSelector*>(
+          m_player_search_properties[m_game->GetCurrentPlayer()]
+              .GetSelector()
+              .get())) {
+  if (m_batch_size > SearchNode::MAX_N_WAITERS) {
+    throw std::invalid_argument("Batch size above " +
+                                std::to_string(SearchNode::MAX_N_WAITERS));
+  }
+  if (options.use_transpositions) {
+    // Aliases and the transposition table would point into pruned subtrees
+    if (m_max_n_nodes != 0 || m_node_budget) {
+      throw std::invalid_argument(
+          "Node limits are not available with transpositions");
+    }
+    m_transpositions.reset(m_game->ClassMethods().CreateGameMap());
+  }
+  std::random_device seeder;
+  m_generator.seed(seeder());
+  PrepareRoot(options.n_iterations);
+}
+
+void oaz::mcts::Search::PrepareRoot(size_t n_iterations) {
+  // A reused subtree already carries visits; only the remaining ones are run
+  size_t n_existing_visits = m_root->GetNVisits();
+  m_n_iterations =
+      n_iterations > n_existing_visits ? n_iterations - n_existing_visits : 0;
+  if (m_n_sharded_levels != 0) {
+    m_root->ShardStatistics(GetNStatisticsShards());
+  }
+  // A reused subtree counts towards the limits
+  AddNodes(CountNodes(m_root.get()));
   Initialise();
-  PerformSearch();
 }
 
-void oaz::mcts::Search::BackpropagateNode(oaz::mcts::SearchNode* node,
-                                          float value) {
-  while (!node->IsRoot()) {
-    value = 1.0F - value;
-    node->Lock();
-    node->AddValue(value);
-    node->Unlock();
-    node = node->GetParent();
+void oaz::mcts::Search::Reset(const oaz::games::Game& game,
+                              size_t n_iterations,
+                              std::shared_ptr<SearchNode> root) {
+  Relaunch(game, n_iterations, std::move(root));
+  Wait();
+}
+
+void oaz::mcts::Search::Relaunch(const oaz::games::Game& game,
+                                 size_t n_iterations,
+                                 std::shared_ptr<SearchNode> root,
+                                 std::function<void()> callback) {
+  if (!IsDone()) {
+    throw std::logic_error("The previous search is not done");
+  }
+  // A specialised descent only plays games of its class
+  if (m_descent != &Search::Descend<oaz::games::Game, Selector> &&
+      typeid(game) != typeid(*m_game)) {
+    throw std::invalid_argument("Expected a game of the specialised class");
+  }
+  if (typeid(game) == typeid(*m_game)) {
+    m_game->CopyFrom(game);
+  } else {
+    m_game = game.Clone();
+  }
+  ResetRoot(std::move(root));
+  if (m_transpositions) {
+    if (m_reclaimer) {
+      m_reclaimer->Release(std::shared_ptr<oaz::games::Game::GameMap>(
+          std::move(m_transpositions)));
+    }
+    m_transpositions.reset(m_game->ClassMethods().CreateGameMap());
+  }
+  m_gumbel_selector = dynamic_cast<GumbelSelector*>(
+      m_player_search_properties[m_game->GetCurrentPlayer()]
+          .GetSelector()
+          .get());
+  m_gumbel_root = nullptr;
+
+  m_n_selections = 0;
+  m_n_completions = 0;
+  m_n_evaluation_requests = 0;
+  m_n_saved_iterations = 0;
+  m_pruning_requested = false;
+  m_n_prunings = 0;
+  m_cancelled = false;
+  PrepareRoot(n_iterations);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_callback = std::move(callback);
+    m_done = false;
+  }
+  Start();
+}
+
+void oaz::mcts::Search::ResetRoot(std::shared_ptr<SearchNode> root) {
+  if (m_node_budget) {
+    m_node_budget->Remove(m_n_nodes);
+  }
+  m_n_nodes = 0;
+  if (!root && m_root->IsInArena() && m_root.use_count() == 1) {
+    // Nothing else refers to the tree: its arena is recycled. The arena is
+    // owned by the control block of the root, which this keeps alive.
+    std::shared_ptr<oaz::arena::Arena> arena(
+        m_root, oaz::arena::Arena::GetArena(m_root.get()));
+    m_root = nullptr;
+    arena->Reset();
+    m_root = SearchNode::CreateRoot(std::move(arena));
+    return;
+  }
+  if (m_reclaimer) {
+    m_reclaimer->Release(std::move(m_root));
+  }
+  m_root = root ? std::move(root)
+                : SearchNode::CreateRoot(std::make_shared<oaz::arena::Arena>());
+}
+
+void oaz::mcts::Search::BackpropagateNode(
+    const std::vector<oaz::mcts::SearchNode*>& path, float value) const {
+  // The root is left out
+  for (size_t i = path.size() - 1; i != 0; --i) {
+    // An alias stands for the same position as its target
+    if (!path[i]->IsAlias()) {
+      value = 1.0F - value;
+    }
+    path[i]->AddValue(value + m_virtual_loss);
   }
 }
 
@@ -286,33 +810,288 @@ size_t oaz::mcts::Search::GetBatchSize() const { return m_batch_size; }
 void oaz::mcts::Search::HandleCreatedTask() { m_n_active_tasks++; }
 
 void oaz::mcts::Search::HandleFinishedTask() {
-  m_n_active_tasks--;
-  if (Done()) {
-    m_condition.notify_one();
+  // Only the last task to finish reads the counters, as the search may be
+  // destroyed as soon as it is done
+  if (--m_n_active_tasks == 0) {
+    if (GetNCompletions() == GetNIterations()) {
+      Complete();
+    } else if (m_pruning_requested) {
+      PruneAndRestart();
+    }
   }
 }
 
+void oaz::mcts::Search::AddNodes(size_t n_nodes) {
+  m_n_nodes += n_nodes;
+  if (m_node_budget) {
+    m_node_budget->Add(n_nodes);
+  }
+  if (IsOverBudget()) {
+    m_pruning_requested = true;
+  }
+}
+
+bool oaz::mcts::Search::IsOverBudget() const {
+  return (m_max_n_nodes != 0 && m_n_nodes > m_max_n_nodes) ||
+         (m_node_budget && m_node_budget->IsExceeded());
+}
+
+void oaz::mcts::Search::PruneAndRestart() {
+  // No task is left: nothing else touches the tree. Pruning counts as a task,
+  // so that the search does not complete before the selections restart.
+  HandleCreatedTask();
+  PruneTree();
+  ++m_n_prunings;
+  m_pruning_requested = false;
+  StartSelections();
+  HandleFinishedTask();
+}
+
+void oaz::mcts::Search::PruneTree() {
+  // Expanded nodes, the root excepted, by increasing number of visits. A
+  // node has more visits than any of its descendants, which are therefore
+  // pruned first.
+  std::vector<std::pair<size_t, SearchNode*>> nodes;
+  std::vector<SearchNode*> stack(1, m_root.get());
+  while (!stack.empty()) {
+    SearchNode* node = stack.back();
+    stack.pop_back();
+    for (size_t i = 0; i != node->GetNChildren(); ++i) {
+      SearchNode* child = node->GetChild(i);
+      if (!child->IsLeaf()) {
+        nodes.emplace_back(child->GetNVisits(), child);
+        stack.push_back(child);
+      }
+    }
+  }
+  std::stable_sort(
+      nodes.begin(), nodes.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+  auto target = static_cast<size_t>(PRUNING_RATIO * m_n_nodes);
+  size_t n_pruned_nodes = 0;
+  for (const auto& [n_visits, node] : nodes) {
+    if (m_n_nodes - n_pruned_nodes <= target) {
+      break;
+    }
+    n_pruned_nodes += CountNodes(node);
+    node->ClearChildren();
+  }
+  m_n_nodes -= n_pruned_nodes;
+  if (m_node_budget) {
+    m_node_budget->Remove(n_pruned_nodes);
+  }
+}
+
+size_t oaz::mcts::Search::CountNodes(SearchNode* node) {
+  size_t n_nodes = 0;
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    n_nodes += 1 + CountNodes(node->GetChild(i));
+  }
+  return n_nodes;
+}
+
+void oaz::mcts::Search::Complete() {
+  std::function<void()> callback;
+  {
+    // Notifying under the lock guarantees that a waiting thread cannot
+    // destroy the search before this returns
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_done) {
+      return;
+    }
+    m_done = true;
+    callback = std::move(m_callback);
+    m_condition.notify_all();
+  }
+  // Called last, as the search may be relaunched or destroyed from it
+  if (callback) {
+    callback();
+  }
+}
+
+bool oaz::mcts::Search::IsDone() const { return m_done; }
+
+void oaz::mcts::Search::Wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this] { return IsDone(); });
+}
+
 size_t oaz::mcts::Search::GetNActiveTasks() const { return m_n_active_tasks; }
 
 oaz::mcts::SearchNode* oaz::mcts::Search::GetNode(size_t index) {
   return m_nodes[index];
 }
 
-void oaz::mcts::Search::PerformSearch() {
-  for (size_t i = 0; i != GetBatchSize(); ++i) {
-    MaybeSelect(i);
-  }
+void oaz::mcts::Search::Start() {
+  m_deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<float>(m_time_budget));
+  // Starting counts as a task, so that the search does not complete, or get
+  // pruned, before all selections are started. The search is completed here
+  // if nothing was selected, for instance with no iterations to run.
+  HandleCreatedTask();
+  StartSelections();
+  HandleFinishedTask();
+}
 
-  std::unique_lock<std::mutex> lock(m_mutex);
-  m_condition.wait(lock, [this] { return Done(); });
+void oaz::mcts::Search::StartSelections() {
+  if (IsGrouped()) {
+    for (size_t group = 0; group != m_group_selection_tasks.size();
+         ++group) {
+      MaybeSelectGroup(group);
+    }
+  } else {
+    for (size_t i = 0; i != GetBatchSize(); ++i) {
+      MaybeSelect(i);
+    }
+  }
 }
 
 void oaz::mcts::Search::SetNode(size_t index, oaz::mcts::SearchNode* node) {
   m_nodes[index] = node;
 }
 
+size_t oaz::mcts::Search::GetNSavedIterations() const {
+  return m_n_saved_iterations;
+}
+
+size_t oaz::mcts::Search::GetNPrunings() const { return m_n_prunings; }
+
+bool oaz::mcts::Search::HasGumbelRoot() const {
+  return m_gumbel_root != nullptr;
+}
+
+size_t oaz::mcts::Search::GetGumbelMove() const {
+  if (!HasGumbelRoot()) {
+    throw std::logic_error("The search has no Gumbel root");
+  }
+  return m_root->GetChild(m_gumbel_root->GetBestChild())->GetMove();
+}
+
+std::vector<float> oaz::mcts::Search::GetImprovedPolicy() const {
+  if (!HasGumbelRoot()) {
+    throw std::logic_error("The search has no Gumbel root");
+  }
+  std::vector<float> policy;
+  m_gumbel_selector->GetImprovedPolicy(m_root.get(), m_root->GetNChildren(),
+                                       &policy);
+  return policy;
+}
+
+std::vector<std::pair<size_t, size_t>> oaz::mcts::Search::GetFoldedMoves()
+    const {
+  std::vector<std::pair<size_t, size_t>> folded_moves;
+  if (!m_game->IsMirrorSymmetric()) {
+    return folded_moves;
+  }
+  // Both mirror moves have a child unless they were folded
+  std::vector<bool> has_child(m_game->ClassMethods().GetMaxNumberOfMoves(),
+                              false);
+  for (size_t i = 0; i != m_root->GetNMoves(); ++i) {
+    has_child[m_root->GetChildMove(i)] = true;
+  }
+  for (size_t i = 0; i != m_root->GetNMoves(); ++i) {
+    size_t move = m_root->GetChildMove(i);
+    size_t mirror_move = m_game->GetMirrorMove(move);
+    if (!has_child[mirror_move]) {
+      folded_moves.emplace_back(move, mirror_move);
+    }
+  }
+  return folded_moves;
+}
+
+void oaz::mcts::Search::UnfoldPolicy(std::vector<float>* policy) const {
+  for (const auto& [move, mirror_move] : GetFoldedMoves()) {
+    (*policy)[move] /= 2;
+    (*policy)[mirror_move] = (*policy)[move];
+  }
+}
+
 std::shared_ptr<oaz::mcts::SearchNode> oaz::mcts::Search::GetTreeRoot() {
   return m_root;
 }
 
-oaz::mcts::Search::~Search() {}
+void oaz::mcts::Search::Stop() { m_cancelled = true; }
+
+oaz::mcts::Search::~Search() {
+  Stop();
+  Wait();
+  if (m_node_budget) {
+    m_node_budget->Remove(m_n_nodes);
+  }
+  if (m_reclaimer) {
+    m_reclaimer->Release(std::move(m_root));
+    m_reclaimer->Release(std::shared_ptr<oaz::games::Game::GameMap>(
+        std::move(m_transpositions)));
+  }
+}
+
+namespace {
+bool IsInSubtree(oaz::mcts::SearchNode* node,
+                 const oaz::mcts::SearchNode* subtree_root) {
+  for (; node != nullptr; node = node->GetParent()) {
+    if (node == subtree_root) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Turns the aliases under node whose target lies outside the subtree of
+ * subtree_root into leaves, as their targets are about to be freed */
+void ClearOutsideAliases(oaz::mcts::SearchNode* node,
+                         const oaz::mcts::SearchNode* subtree_root) {
+  if (node->IsAlias()) {
+    if (!IsInSubtree(node->GetAliasTarget(), subtree_root)) {
+      node->ClearAlias();
+    }
+    return;
+  }
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    ClearOutsideAliases(node->GetChild(i), subtree_root);
+  }
+}
+}  // namespace
+
+std::shared_ptr<oaz::mcts::SearchNode> oaz::mcts::AdvanceRoot(
+    const std::shared_ptr<oaz::mcts::SearchNode>& root, size_t move,
+    const std::shared_ptr<oaz::reclaimer::Reclaimer>& reclaimer) {
+  for (size_t i = 0; i != root->GetNChildren(); ++i) {
+    if (root->GetChild(i)->GetMove() == move) {
+      ClearOutsideAliases(root->GetChild(i), root->GetChild(i));
+      if (root->IsInArena()) {
+        if (!reclaimer) {
+          // The subtree stays in the arena, which the new root keeps alive
+          return std::shared_ptr<oaz::mcts::SearchNode>(root,
+                                                        root->DetachChild(i));
+        }
+        // The siblings are no longer reachable, but their memory is only
+        // returned to the arena later, which the job keeps alive meanwhile
+        auto siblings = std::make_shared<std::vector<SearchNode*>>();
+        SearchNode* child = root->DetachChild(i, siblings.get());
+        reclaimer->Defer([root, siblings] {
+          for (SearchNode* sibling : *siblings) {
+            sibling->FreeSubtree();
+          }
+        });
+        return std::shared_ptr<oaz::mcts::SearchNode>(root, child);
+      }
+      auto subtree = std::make_shared<oaz::mcts::SearchNode>(
+          std::move(*root->GetChild(i)));
+      if (reclaimer) {
+        // The children are moved to a node that only the reclaimer holds
+        reclaimer->Release(
+            std::make_shared<oaz::mcts::SearchNode>(std::move(*root)));
+      } else {
+        root->ClearChildren();
+      }
+      return subtree;
+    }
+  }
+  if (root->IsInArena()) {
+    return oaz::mcts::SearchNode::CreateRoot(std::shared_ptr<oaz::arena::Arena>(
+        root, oaz::arena::Arena::GetArena(root.get())));
+  }
+  return std::make_shared<oaz::mcts::SearchNode>();
+}
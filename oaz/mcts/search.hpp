@@ -5,17 +5,27 @@
   #define TEST_FRIENDS
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "boost/multi_array.hpp"
+#include "oaz/arena/arena.hpp"
 #include "oaz/evaluator/evaluator.hpp"
 #include "oaz/games/game.hpp"
+#include "oaz/mcts/gumbel_root.hpp"
 #include "oaz/mcts/search_node.hpp"
 #include "oaz/mcts/selection.hpp"
 #include "oaz/mutex/mutex.hpp"
+#include "oaz/reclaimer/reclaimer.hpp"
 #include "oaz/thread_pool/thread_pool.hpp"
 
 namespace oaz::mcts {
@@ -35,8 +45,131 @@ class PlayerSearchProperties {
     std::shared_ptr<oaz::mcts::Selector> m_selector;
 };
 
+/* Lets another thread stop a search. Selections in flight when the token is
+ * stopped are completed, so that the tree remains consistent. */
+class StopToken {
+ public:
+  StopToken() : m_stopped(false) {}
+  void Stop() { m_stopped = true; }
+  void Reset() { m_stopped = false; }
+  bool IsStopped() const { return m_stopped; }
+
+ private:
+  std::atomic<bool> m_stopped;
+};
+
+/* Caps the number of nodes in the trees of all the searches sharing it.
+ * Each search counts the nodes of its tree for as long as it lives. */
+class NodeBudget {
+ public:
+  explicit NodeBudget(size_t max_n_nodes)
+      : m_max_n_nodes(max_n_nodes), m_n_nodes(0) {}
+  void Add(size_t n_nodes) { m_n_nodes += n_nodes; }
+  void Remove(size_t n_nodes) { m_n_nodes -= n_nodes; }
+  size_t GetNNodes() const { return m_n_nodes; }
+  size_t GetMaxNNodes() const { return m_max_n_nodes; }
+  bool IsExceeded() const { return m_n_nodes > m_max_n_nodes; }
+
+ private:
+  size_t m_max_n_nodes;
+  std::atomic<size_t> m_n_nodes;
+};
+
+class SearchOptions {
+ public:
+  SearchOptions()
+      : batch_size(1),
+        n_iterations(0),
+        noise_epsilon(0.),
+        noise_alpha(1.),
+        virtual_loss(0.),
+        n_sharded_levels(0),
+        time_budget(0.),
+        stop_token(nullptr),
+        use_transpositions(false),
+        use_solver(false),
+        stop_when_decided(false),
+        widening_constant(0.),
+        widening_exponent(0.5),
+        n_leaves_per_task(1),
+        reclaimer(nullptr),
+        max_n_nodes(0),
+        node_budget(nullptr),
+        fold_symmetries(false) {}
+
+  size_t batch_size;
+  size_t n_iterations;
+  float noise_epsilon;
+  float noise_alpha;
+  /* Value withdrawn from each node on the path of a selection until its
+   * evaluation is backpropagated, so that concurrent selections are steered
+   * towards different leaves. With no virtual loss, selections reaching a
+   * leaf that awaits evaluation are paused until it is expanded. */
+  float virtual_loss;
+  /* Number of levels of the tree, starting from the root, whose nodes keep
+   * their statistics in one shard per worker of the thread pool to avoid
+   * contention between threads. Each sharded node takes an extra cache line
+   * per worker, plus two. */
+  size_t n_sharded_levels;
+  /* Time in seconds after which no new selection is started, or 0 for no
+   * limit. The search stops at the deadline or after n_iterations,
+   * whichever comes first. */
+  float time_budget;
+  std::shared_ptr<StopToken> stop_token;
+  /* Whether positions reached through different paths share their node, so
+   * that each is expanded and evaluated once. The game must not allow a
+   * position to repeat within a game. */
+  bool use_transpositions;
+  /* Whether wins, losses and draws found at the end of games are propagated
+   * up the tree by minimax. Selections avoid proven nodes, and the search
+   * stops as soon as the root is proven. Scores must be those of a win, a
+   * draw or a loss. */
+  bool use_solver;
+  /* Whether the search stops once the most visited child of the root can no
+   * longer be overtaken by another child with the iterations left */
+  bool stop_when_decided;
+  /* Progressive widening: with a positive constant, the children of a node
+   * are ordered by decreasing prior, and selections from a node with n
+   * visits only consider the first
+   *   ceil(widening_constant * n ^ widening_exponent)
+   * children, so that moves with low priors are only tried once the node
+   * has been visited enough. Only the moves and priors of the other children
+   * are kept: their nodes are built once widening reveals them. */
+  float widening_constant;
+  float widening_exponent;
+  /* With more than one leaf per task, the batch_size concurrent selections
+   * are split into groups of n_leaves_per_task. A single task selects a
+   * leaf for each selection of a group in one pass and hands them to the
+   * evaluator together; the group is selected again once all its leaves
+   * are backpropagated. Leaves are distinct if virtual_loss is positive. */
+  size_t n_leaves_per_task;
+  /* If set, the tree and the transposition table of the search are released
+   * on the thread of the reclaimer when the search is destroyed. The tree is
+   * only freed there if no other reference to its root is left. */
+  std::shared_ptr<oaz::reclaimer::Reclaimer> reclaimer;
+  /* Once the tree holds more than max_n_nodes nodes, if positive, or once
+   * node_budget is exceeded, the selections in flight are completed and the
+   * least visited subtrees are freed, until the tree is down to
+   * PRUNING_RATIO of its size; the search then goes on. Expansions in flight
+   * may overshoot the limits by a few nodes. A pruned node keeps its
+   * statistics, and is evaluated and expanded again if selected. Pruning
+   * is not available with use_transpositions. */
+  size_t max_n_nodes;
+  std::shared_ptr<NodeBudget> node_budget;
+  /* Whether, if the game at the root is its own mirror image, the root
+   * keeps a single child for each pair of mirror moves, with the sum of
+   * their priors, so that equivalent moves share their simulations. Policies
+   * over the root moves are to be passed through Search::UnfoldPolicy. */
+  bool fold_symmetries;
+};
+
+/* The constructors of Search block until the search is done. Launch instead
+ * starts the search on the thread pool and returns at once, so that a single
+ * thread can drive many searches sharing the same evaluator. */
 class Search {
   TEST_FRIENDS;
+  template <class, class>
+  friend class SpecialisedSearch;
 
  public:
   Search(const oaz::games::Game&,
@@ -46,9 +179,69 @@ class Search {
          const std::vector<oaz::mcts::PlayerSearchProperties>&,
          std::shared_ptr<oaz::thread_pool::ThreadPool>, size_t, size_t, float,
          float);
+  Search(const oaz::games::Game&,
+         const std::vector<oaz::mcts::PlayerSearchProperties>&,
+         std::shared_ptr<oaz::thread_pool::ThreadPool>, size_t, size_t, float,
+         float, std::shared_ptr<SearchNode>);
+  Search(const oaz::games::Game&,
+         const std::vector<oaz::mcts::PlayerSearchProperties>&,
+         std::shared_ptr<oaz::thread_pool::ThreadPool>, const SearchOptions&,
+         std::shared_ptr<SearchNode> = nullptr);
+
+  /* Starts a search without waiting for it. Once the search is done, the
+   * callback, if any, is called from a thread of the pool; it must not block.
+   * Destroying a search that is not done stops it and waits for it. The
+   * callback is called after the search is marked done, so that it may
+   * relaunch or destroy the search: Wait, IsDone and the destructor do not
+   * wait for it, and whatever it refers to must stay alive until it has run,
+   * for instance by draining the queue it pushes to. */
+  static std::shared_ptr<Search> Launch(
+      const oaz::games::Game&,
+      const std::vector<oaz::mcts::PlayerSearchProperties>&,
+      std::shared_ptr<oaz::thread_pool::ThreadPool>, const SearchOptions&,
+      std::shared_ptr<SearchNode> = nullptr,
+      std::function<void()> = nullptr);
+
+  /* Searches another position with the same options and players, reusing
+   * the buffers, games and tasks of this search instead of allocating them
+   * again. Without a root, the nodes of the previous tree are recycled if
+   * nothing else refers to them; otherwise, the previous tree is released
+   * like that of a destroyed search. The previous search must be done. Reset
+   * blocks until the new search is done, while Relaunch returns at once and
+   * calls callback, if any, like Launch. */
+  void Reset(const oaz::games::Game&, size_t n_iterations,
+             std::shared_ptr<SearchNode> = nullptr);
+  void Relaunch(const oaz::games::Game&, size_t n_iterations,
+                std::shared_ptr<SearchNode> = nullptr,
+                std::function<void()> = nullptr);
+
+  bool IsDone() const;
+  void Wait();
+  /* Starts no new selection; the search is done once the selections in
+   * flight are completed */
+  void Stop();
 
   /* void seedRNG(size_t); */
   std::shared_ptr<SearchNode> GetTreeRoot();
+  /* Number of iterations left out because the outcome of the search was
+   * already determined, by stop_when_decided or by the solver */
+  size_t GetNSavedIterations() const;
+  /* Number of times the tree was pruned to fit the node limits */
+  size_t GetNPrunings() const;
+  /* Whether the player to move at the root uses a GumbelSelector and the
+   * root was expanded, in which case the search is done with a GumbelRoot.
+   * The move to play is then chosen by the search, and the improved policy
+   * over the children of the root, in their order, is the policy to train
+   * on. Only meant to be called once the search is done. */
+  bool HasGumbelRoot() const;
+  size_t GetGumbelMove() const;
+  std::vector<float> GetImprovedPolicy() const;
+  /* Pairs of a move of the root and of its mirror move, which was folded
+   * into it by fold_symmetries. UnfoldPolicy splits the probability of each
+   * such move evenly with its mirror move, in a policy indexed by move.
+   * Only meant to be called once the search is done. */
+  std::vector<std::pair<size_t, size_t>> GetFoldedMoves() const;
+  void UnfoldPolicy(std::vector<float>*) const;
 
   ~Search();
   Search(const Search&) = delete;
@@ -58,6 +251,16 @@ class Search {
 
  private:
   static constexpr float EPS_THRESHOLD = 0.001;
+  static constexpr size_t PATH_CAPACITY = 64;
+  static constexpr float PRUNING_RATIO = 0.75;
+
+  enum class SelectionOutcome { EVALUATION, PAUSED, DONE };
+  using Descent = SelectionOutcome (Search::*)(size_t);
+
+  Search(const oaz::games::Game&,
+         const std::vector<oaz::mcts::PlayerSearchProperties>&,
+         std::shared_ptr<oaz::thread_pool::ThreadPool>, const SearchOptions&,
+         std::shared_ptr<SearchNode>, std::function<void()>, Descent);
   class SelectionTask : public oaz::thread_pool::Task {
    public:
     SelectionTask(Search*, size_t);
@@ -69,6 +272,17 @@ class Search {
     size_t m_index;
   };
 
+  class GroupSelectionTask : public oaz::thread_pool::Task {
+   public:
+    GroupSelectionTask(Search*, size_t);
+    GroupSelectionTask();
+    void operator()() override;
+
+   private:
+    Search* m_search;
+    size_t m_group;
+  };
+
   class ExpansionAndBackpropagationTask : public oaz::thread_pool::Task {
    public:
     ExpansionAndBackpropagationTask(Search*, size_t);
@@ -87,9 +301,12 @@ class Search {
   size_t GetNActiveTasks() const;
   size_t GetEvaluatorIndex(size_t) const;
   bool Done() const;
+  bool ShouldStop() const;
+  bool IsDecided() const;
 
   oaz::games::Game* GetGame(size_t);
   void ResetGame(size_t);
+  void RewindGame(size_t);
   std::unique_ptr<oaz::evaluator::Evaluation>* GetEvaluation(size_t);
   SearchNode* GetNode(size_t);
 
@@ -98,37 +315,83 @@ class Search {
   void IncrementNCompletions();
 
   void Initialise();
+  void PrepareRoot(size_t);
+  void ResetRoot(std::shared_ptr<SearchNode>);
   void Deinitialise();
 
   void HandleFinishedTask();
   void HandleCreatedTask();
-
-  void SelectNode(size_t);
+  void Complete();
+
+  /* Descends from the node of the selection until a leaf to evaluate is
+   * reached. Finished games on the way are backpropagated and followed by
+   * new selections; DONE means that no selection is left. */
+  SelectionOutcome SelectNode(size_t);
+  /* The descent of SelectNode, with the game and the selectors cast to
+   * GameT and SelectorT. The calls to them are resolved at compile time
+   * when these classes are final. */
+  template <class GameT, class SelectorT>
+  SelectionOutcome Descend(size_t);
+  void SelectAndRequestEvaluation(size_t);
+  void RequestEvaluations(const size_t*, size_t);
+  bool IsGrouped() const;
+  void SelectGroup(size_t);
+  void FinishGroupLeaf(size_t);
+  void MaybeSelectGroup(size_t);
   void ExpandNode(SearchNode* node, oaz::games::Game*, oaz::evaluator::Evaluation*);
-  static void BackpropagateNode(SearchNode*, float);
+  /* Builds the pending children of a node up to n. Must be called with the
+   * node locked. */
+  void BuildChildren(SearchNode*, oaz::games::Game*, size_t n);
+  /* Sets up the children of a node in [begin, end) before they are visible
+   * to other threads */
+  void SetUpChildren(SearchNode*, oaz::games::Game*, size_t begin,
+                     size_t end);
+  void AddTranspositions(SearchNode*, oaz::games::Game*, size_t begin,
+                         size_t end);
+  void BackpropagateNode(const std::vector<SearchNode*>&, float) const;
   void ExpandAndBackpropagateNode(size_t);
+  void CompleteIteration(size_t, float);
+  static float GetTerminalValue(const oaz::games::Game&);
+  void SetTerminalProvenValue(SearchNode*, float) const;
+  void PropagateProvenValues(const std::vector<SearchNode*>&) const;
+  static bool Prove(SearchNode*);
+  bool ReserveSelection();
+  void StartSelections();
+  void AddNodes(size_t);
+  bool IsOverBudget() const;
+  void PruneAndRestart();
+  void PruneTree();
+  static size_t CountNodes(SearchNode*);
   void MaybeSelect(size_t);
+  void AddVirtualLoss(SearchNode*) const;
+  size_t GetNSelectableChildren(SearchNode*) const;
+  size_t GetNStatisticsShards() const;
+  size_t SelectGumbelRootChild();
   void Pause(size_t);
   void Unpause(SearchNode*);
 
   void AddDirichletNoise(boost::multi_array<float, 1>&);
-  void PerformSearch();
+  void Start();
 
   size_t m_batch_size;
 
   std::vector<SearchNode*> m_nodes;
+  // Nodes traversed by each selection, from the root. Transpositions make
+  // the path differ from the chain of parents.
+  std::vector<std::vector<SearchNode*>> m_paths;
   std::vector<std::unique_ptr<oaz::games::Game>> m_games;
 
   boost::multi_array<std::unique_ptr<oaz::evaluator::Evaluation>, 1> m_evaluations;
 
   std::mt19937 m_generator;  // Check if thread safe
 
-  std::vector<SearchNode*> m_paused_nodes;
+  // Next slot, plus one, in the chain of selections paused on the same leaf
+  std::vector<size_t> m_next_waiters;
 
   oaz::mutex::SpinlockMutex m_selection_lock;
 
   size_t m_n_selections;
-  size_t m_n_iterations;
+  std::atomic<size_t> m_n_iterations;
 
   std::atomic<size_t> m_n_completions;
   std::atomic<size_t> m_n_evaluation_requests;
@@ -136,11 +399,47 @@ class Search {
 
   float m_noise_epsilon;
   float m_noise_alpha;
+  float m_virtual_loss;
+  size_t m_n_sharded_levels;
+
+  float m_time_budget;
+  std::chrono::steady_clock::time_point m_deadline;
+  std::shared_ptr<StopToken> m_stop_token;
+
+  // Maps the positions of the nodes created by this search to the nodes
+  std::unique_ptr<oaz::games::Game::GameMap> m_transpositions;
+  oaz::mutex::SpinlockMutex m_transpositions_lock;
+
+  bool m_use_solver;
+  bool m_stop_when_decided;
+  float m_widening_constant;
+  float m_widening_exponent;
+  std::atomic<size_t> m_n_saved_iterations;
+  std::shared_ptr<oaz::reclaimer::Reclaimer> m_reclaimer;
+
+  size_t m_max_n_nodes;
+  std::shared_ptr<NodeBudget> m_node_budget;
+  // Nodes of the tree, the root excepted
+  std::atomic<size_t> m_n_nodes;
+  std::atomic<bool> m_pruning_requested;
+  size_t m_n_prunings;
+
+  bool m_fold_symmetries;
 
   std::condition_variable m_condition;
   std::mutex m_mutex;
+  std::atomic<bool> m_done;
+  std::function<void()> m_callback;
+  std::atomic<bool> m_cancelled;
 
   boost::multi_array<SelectionTask, 1> m_selection_tasks;
+  // Player whose evaluator is asked for the leaf of each selection
+  std::vector<size_t> m_evaluator_indices;
+
+  size_t m_n_leaves_per_task;
+  // Leaves of each group that are not yet backpropagated
+  std::unique_ptr<std::atomic<size_t>[]> m_n_pending_group_leaves;
+  boost::multi_array<GroupSelectionTask, 1> m_group_selection_tasks;
   boost::multi_array<ExpansionAndBackpropagationTask, 1>
       m_expansion_and_backpropagation_tasks;
 
@@ -149,8 +448,165 @@ class Search {
 
   std::unique_ptr<oaz::games::Game> m_game;
   std::vector<oaz::mcts::PlayerSearchProperties> m_player_search_properties;
+  Descent m_descent;
+
+  // Set if the player to move at the root uses a GumbelSelector. The
+  // GumbelRoot is created by the first selection after the root is expanded.
+  GumbelSelector* m_gumbel_selector;
+  std::unique_ptr<GumbelRoot> m_gumbel_root;
+  oaz::mutex::SpinlockMutex m_gumbel_lock;
+};
+
+/* A Search whose descent calls GameT and SelectorT directly rather than
+ * through their base classes, so that the compiler can inline them, for
+ * instance SpecialisedSearch<ConnectFour, AZSelector>. The game and the
+ * selectors of all players must be of these types. */
+template <class GameT, class SelectorT>
+class SpecialisedSearch final : public Search {
+ public:
+  SpecialisedSearch(
+      const oaz::games::Game& game,
+      const std::vector<oaz::mcts::PlayerSearchProperties>&
+          player_search_properties,
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+      const SearchOptions& options, std::shared_ptr<SearchNode> root = nullptr)
+      : SpecialisedSearch(game, player_search_properties,
+                          std::move(thread_pool), options, std::move(root),
+                          nullptr) {
+    Start();
+    Wait();
+  }
+
+  static std::shared_ptr<Search> Launch(
+      const oaz::games::Game& game,
+      const std::vector<oaz::mcts::PlayerSearchProperties>&
+          player_search_properties,
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+      const SearchOptions& options, std::shared_ptr<SearchNode> root = nullptr,
+      std::function<void()> callback = nullptr) {
+    std::shared_ptr<Search> search(new SpecialisedSearch(
+        game, player_search_properties, std::move(thread_pool), options,
+        std::move(root), std::move(callback)));
+    search->Start();
+    return search;
+  }
+
+ private:
+  SpecialisedSearch(const oaz::games::Game& game,
+                    const std::vector<oaz::mcts::PlayerSearchProperties>&
+                        player_search_properties,
+                    std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+                    const SearchOptions& options,
+                    std::shared_ptr<SearchNode> root,
+                    std::function<void()> callback)
+      : Search(CheckTypes(game, player_search_properties),
+               player_search_properties, std::move(thread_pool), options,
+               std::move(root), std::move(callback),
+               &Search::Descend<GameT, SelectorT>) {}
+
+  static const oaz::games::Game& CheckTypes(
+      const oaz::games::Game& game,
+      const std::vector<oaz::mcts::PlayerSearchProperties>&
+          player_search_properties) {
+    if (dynamic_cast<const GameT*>(&game) == nullptr) {
+      throw std::invalid_argument("Game of the wrong type");
+    }
+    for (PlayerSearchProperties properties : player_search_properties) {
+      if (dynamic_cast<SelectorT*>(properties.GetSelector().get()) ==
+          nullptr) {
+        throw std::invalid_argument("Selector of the wrong type");
+      }
+    }
+    return game;
+  }
 };
 
+template <class GameT, class SelectorT>
+Search::SelectionOutcome Search::Descend(size_t index) {
+  SearchNode* node = GetNode(index);
+  auto* game = static_cast<GameT*>(GetGame(index));
+
+  size_t current_player = game->GetCurrentPlayer();
+  std::vector<SearchNode*>& path = m_paths[index];
+
+  while (true) {
+    if (node->IsAlias()) {
+      // The target stands for the same position: no move is played
+      node->IncrementNVisits();
+      AddVirtualLoss(node);
+      node = node->GetAliasTarget();
+      path.push_back(node);
+      SetNode(index, node);
+      continue;
+    }
+
+    // Only leaves are locked: expanded nodes are traversed lock-free
+    if (!node->IsExpanded()) {
+      node->Lock();
+      if (node->IsLeaf()) {
+        if (node->IsBlockedForEvaluation()) {
+          Pause(index);
+          node->Unlock();
+          return SelectionOutcome::PAUSED;
+        }
+        node->IncrementNVisits();
+        AddVirtualLoss(node);
+        if (game->IsFinished()) {
+          node->Unlock();
+          // The value is known: the iteration is completed on this thread,
+          // and the next one is started without going through the pool
+          float value = GetTerminalValue(*game);
+          SetTerminalProvenValue(node, value);
+          CompleteIteration(index, value);
+          if (!ReserveSelection()) {
+            return SelectionOutcome::DONE;
+          }
+          node = GetNode(index);
+          current_player = game->GetCurrentPlayer();
+          continue;
+        }
+        node->BlockForEvaluation();
+        node->Unlock();
+        m_evaluator_indices[index] = current_player;
+        return SelectionOutcome::EVALUATION;
+      }
+      node->Unlock();
+    }
+
+    node->IncrementNVisits();
+    AddVirtualLoss(node);
+    size_t child_index = 0;
+    // Gumbel roots sample among all their children
+    bool gumbel_root = node == m_root.get() && m_gumbel_selector != nullptr;
+    size_t n_children =
+        gumbel_root ? node->GetNMoves() : GetNSelectableChildren(node);
+    if (n_children > node->GetNChildren()) {
+      node->Lock();
+      BuildChildren(node, game, n_children);
+      node->Unlock();
+    }
+    if (gumbel_root) {
+      child_index = SelectGumbelRootChild();
+    } else {
+      auto& selector = static_cast<SelectorT&>(
+          *m_player_search_properties[current_player].GetSelector());
+      child_index = selector(node, n_children);
+    }
+    node = node->GetChild(child_index);
+    game->PlayMove(node->GetMove());
+    path.push_back(node);
+    SetNode(index, node);
+  }
+}
+
+/* Returns the subtree found under the child of root corresponding to move, so
+ * that it can be passed to the Search of the next position. The siblings of
+ * that child are freed, on the thread of reclaimer if one is given. If root
+ * has no such child, a fresh root is returned. */
+std::shared_ptr<SearchNode> AdvanceRoot(
+    const std::shared_ptr<SearchNode>&, size_t,
+    const std::shared_ptr<oaz::reclaimer::Reclaimer>& = nullptr);
+
 }  // namespace oaz::mcts
 
 #endif  // OAZ_MCTS_SEARCH_HPP_
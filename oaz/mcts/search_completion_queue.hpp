@@ -0,0 +1,61 @@
+#ifndef OAZ_MCTS_SEARCH_COMPLETION_QUEUE_HPP_
+#define OAZ_MCTS_SEARCH_COMPLETION_QUEUE_HPP_
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+
+namespace oaz::mcts {
+
+/* Collects the keys of launched searches as they complete, so that a single
+ * thread can wait on many searches at once. Push is meant to be called from
+ * the completion callback of Search::Launch. */
+class SearchCompletionQueue {
+ public:
+  void Push(size_t key) {
+    // Notifying under the lock lets the queue be destroyed as soon as the
+    // last key is popped
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys.push(key);
+    m_condition.notify_one();
+  }
+
+  /* Waits for a search to complete and returns its key */
+  size_t Pop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return !m_keys.empty(); });
+    return PopLocked();
+  }
+
+  /* Returns false if no search completed within timeout seconds */
+  bool TryPop(size_t* key, double timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_condition.wait_for(lock, std::chrono::duration<double>(timeout),
+                              [this] { return !m_keys.empty(); })) {
+      return false;
+    }
+    *key = PopLocked();
+    return true;
+  }
+
+  size_t GetSize() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_keys.size();
+  }
+
+ private:
+  size_t PopLocked() {
+    size_t key = m_keys.front();
+    m_keys.pop();
+    return key;
+  }
+
+  std::queue<size_t> m_keys;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+};
+}  // namespace oaz::mcts
+#endif  // OAZ_MCTS_SEARCH_COMPLETION_QUEUE_HPP_
@@ -3,94 +3,370 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <cstring>
 #include <iterator>
 #include <memory>
+#include <new>
 #include <utility>
 #include <vector>
 
-#include "oaz/mutex/mutex.hpp"
+#include "oaz/arena/arena.hpp"
+#include "oaz/thread_pool/thread_pool.hpp"
 
 namespace oaz::mcts {
+
+/* Game-theoretic value of a node, from the point of view of the player who
+ * played the move leading to it, like its accumulated value */
+enum class ProvenValue : uint8_t { UNKNOWN = 0, LOSS = 1, DRAW = 2, WIN = 3 };
+
 class SearchNode {
  public:
   SearchNode()
       : m_parent(nullptr),
-        m_player(0),
-        m_n_visits(0),
-        m_acc_value(0.),
+        m_children(nullptr),
+        m_statistics(0),
         m_prior(0.),
         m_move(0),
-        m_is_blocked_for_evaluation(false) {}
+        m_n_children(0),
+        m_children_capacity(0),
+        m_state(0),
+        m_player(0),
+        m_first_waiter(0) {}
   SearchNode(size_t move, size_t player, SearchNode* parent, float prior)
-      : m_move(move),
-        m_player(player),
-        m_parent(parent),
-        m_n_visits(0),
-        m_acc_value(0.),
+      : m_parent(parent),
+        m_children(nullptr),
+        m_statistics(0),
         m_prior(prior),
-        m_is_blocked_for_evaluation(false) {}
+        m_move(move),
+        m_n_children(0),
+        m_children_capacity(0),
+        m_state(0),
+        m_player(player),
+        m_first_waiter(0) {}
   SearchNode(const SearchNode& rhs)
-      : m_move(rhs.m_move),
-        m_player(rhs.m_player),
-        m_parent(nullptr),
-        m_n_visits(rhs.m_n_visits),
-        m_acc_value(rhs.m_acc_value),
+      : m_parent(nullptr),
+        m_children(nullptr),
+        m_statistics(rhs.GetMergedStatistics()),
         m_prior(rhs.m_prior),
-        m_is_blocked_for_evaluation(false) {
-    for (size_t i = 0; i != rhs.GetNChildren(); ++i) {
-      std::unique_ptr<SearchNode> child =
-          std::make_unique<SearchNode>(*rhs.m_children[i]);
-      child->SetParent(this);
-      m_children.push_back(std::move(child));
+        m_move(rhs.m_move),
+        m_n_children(0),
+        m_children_capacity(0),
+        m_state(0),
+        m_player(rhs.m_player),
+        m_first_waiter(0) {
+    size_t n_children = rhs.GetNChildren();
+    if (rhs.HasPendingChildren()) {
+      m_children = AllocateChildren(rhs.m_children_capacity, true);
+      m_children_capacity = rhs.m_children_capacity;
+      std::memcpy(GetPendingChildren(), rhs.GetPendingChildren(),
+                  m_children_capacity * sizeof(PendingChild));
+    } else {
+      ReserveChildren(n_children);
     }
+    for (size_t i = 0; i != n_children; ++i) {
+      new (&m_children[i]) SearchNode(rhs.m_children[i]);
+      m_children[i].SetParent(this);
+    }
+    m_n_children.store(n_children, std::memory_order_relaxed);
+    m_state = rhs.m_state & (EXPANDED | PROVEN | PENDING);
   }
 
   SearchNode(SearchNode&& rhs) noexcept
-      : m_move(rhs.m_move),
-        m_player(rhs.m_player),
-        m_parent(nullptr),
-        m_n_visits(rhs.m_n_visits),
-        m_acc_value(rhs.m_acc_value),
+      : m_parent(nullptr),
+        m_children(rhs.m_children),
+        m_statistics(rhs.m_statistics.load(std::memory_order_relaxed)),
         m_prior(rhs.m_prior),
-        m_is_blocked_for_evaluation(false) {
-    m_children.resize(rhs.GetNChildren());
-    for (size_t i = 0; i != rhs.GetNChildren(); ++i) {
-      m_children[i] = std::move(rhs.m_children[i]);
-      rhs.m_children[i] = std::move(rhs.m_children[i]);
+        m_move(rhs.m_move),
+        m_n_children(rhs.m_n_children.load(std::memory_order_relaxed)),
+        m_children_capacity(rhs.m_children_capacity),
+        m_state(rhs.m_state &
+                (IN_ARENA | EXPANDED | SHARDED | ALIAS | PROVEN | PENDING)),
+        m_player(rhs.m_player),
+        m_first_waiter(0) {
+    for (size_t i = 0; i != GetNChildren(); ++i) {
+      m_children[i].SetParent(this);
     }
+    rhs.m_children = nullptr;
+    rhs.m_n_children = 0;
+    rhs.m_children_capacity = 0;
+    rhs.m_statistics = 0;
+    rhs.m_state.fetch_and(~(EXPANDED | SHARDED | ALIAS | PROVEN | PENDING));
   }
 
   SearchNode& operator=(const SearchNode&) = delete;
   SearchNode& operator=(SearchNode&&) = delete;
-  ~SearchNode() = default;
+
+  /* Nodes allocated in an arena are never destroyed individually: their
+   * memory is reclaimed with the arena. */
+  ~SearchNode() {
+    if (!IsInArena()) {
+      FreeChildren();
+      ReleaseShardedStatistics();
+    }
+  }
+
+  /* Creates a root node whose subtree is allocated from arena. The returned
+   * pointer keeps the arena alive. */
+  static std::shared_ptr<SearchNode> CreateRoot(
+      std::shared_ptr<oaz::arena::Arena> arena) {
+    auto* root = new (arena->Allocate(sizeof(SearchNode))) SearchNode();
+    root->m_state = IN_ARENA;
+    return std::shared_ptr<SearchNode>(std::move(arena), root);
+  }
 
   size_t GetMove() const { return m_move; }
   size_t GetPlayer() const { return m_player; }
   bool IsRoot() const { return m_parent == nullptr; }
-  bool IsLeaf() const { return m_children.empty(); }
+  bool IsLeaf() const { return GetNChildren() == 0; }
+  bool IsInArena() const { return (m_state & IN_ARENA) != 0; }
+
+  /* Whether all the children of this node have been added. The children of
+   * an expanded node are never modified or moved, so that it can be
+   * traversed without taking its lock; only its pending children are still
+   * built, under the lock, and published through GetNChildren. */
+  bool IsExpanded() const {
+    return (m_state.load(std::memory_order_acquire) & EXPANDED) != 0;
+  }
+  void SetExpanded() { m_state.fetch_or(EXPANDED, std::memory_order_release); }
+
+  /* An alias is a leaf standing for the same position as its target, which
+   * was reached through another path. Selections go on from the target, so
+   * that the position is expanded and evaluated once. The alias keeps the
+   * statistics of its own edge but does not own the target. */
+  bool IsAlias() const { return (m_state & ALIAS) != 0; }
+  SearchNode* GetAliasTarget() const { return m_children; }
+  /* Must be called before the node is shared between threads */
+  void SetAliasTarget(SearchNode* target) {
+    m_children = target;
+    m_state.fetch_or(ALIAS);
+  }
+  /* Turns the alias back into an unexpanded leaf */
+  void ClearAlias() {
+    m_children = nullptr;
+    m_state.fetch_and(~ALIAS);
+  }
+
+  /* Proven values only ever change from UNKNOWN. An alias has the proven
+   * value of its target. */
+  ProvenValue GetProvenValue() const {
+    const SearchNode* node = IsAlias() ? GetAliasTarget() : this;
+    return static_cast<ProvenValue>(
+        (node->m_state.load(std::memory_order_acquire) & PROVEN) >>
+        PROVEN_SHIFT);
+  }
+  bool IsProven() const { return GetProvenValue() != ProvenValue::UNKNOWN; }
+  /* Returns false if the node was already proven */
+  bool SetProvenValue(ProvenValue value) {
+    uint16_t state = m_state.load(std::memory_order_relaxed);
+    while ((state & PROVEN) == 0) {
+      uint16_t proven_state =
+          state | (static_cast<uint16_t>(value) << PROVEN_SHIFT);
+      if (m_state.compare_exchange_weak(state, proven_state,
+                                        std::memory_order_release)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /* Allocates room for n children in one block, so that the following n
+   * calls to AddChild do not allocate. Not for nodes with pending children,
+   * whose block is never moved. */
+  void ReserveChildren(size_t n) {
+    if (n <= m_children_capacity) {
+      return;
+    }
+    SearchNode* children = AllocateChildren(n, false);
+    for (size_t i = 0; i != GetNChildren(); ++i) {
+      new (&children[i]) SearchNode(std::move(m_children[i]));
+      children[i].SetParent(this);
+    }
+    ReleaseChildrenBlock();
+    m_children = children;
+    m_children_capacity = n;
+  }
+
   void AddChild(size_t move, size_t player, float prior) {
-    std::unique_ptr<SearchNode> child(
-        new SearchNode(move, player, this, prior));
-    m_children.push_back(std::move(child));
+    size_t n_children = GetNChildren();
+    if (n_children == m_children_capacity) {
+      ReserveChildren(m_children_capacity == 0 ? 1 : 2 * m_children_capacity);
+    }
+    SearchNode* child =
+        new (&m_children[n_children]) SearchNode(move, player, this, prior);
+    child->m_state = m_state & IN_ARENA;
+    m_n_children.store(n_children + 1, std::memory_order_release);
+  }
+  SearchNode* GetChild(size_t index) { return &m_children[index]; }
+  /* Children built so far. Loading the count with acquire ordering makes
+   * them visible to threads traversing the node without its lock. */
+  size_t GetNChildren() const {
+    return m_n_children.load(std::memory_order_acquire);
+  }
+
+  /* Pending children are known by their move and prior only, and are built
+   * in the given order as they are needed, so that moves which are never
+   * selected do not take a whole node. The children block is reserved for
+   * all of them at once, followed by their moves and priors, so that built
+   * children never move. The moves and priors are given as (prior, move)
+   * pairs; the children have player as their player. Must be called on a
+   * leaf before it is expanded. */
+  void SetPendingChildren(const std::vector<std::pair<float, size_t>>& children,
+                          size_t player) {
+    m_children = AllocateChildren(children.size(), true);
+    m_children_capacity = children.size();
+    m_state.fetch_or(PENDING);
+    PendingChild* pending_children = GetPendingChildren();
+    for (size_t i = 0; i != children.size(); ++i) {
+      pending_children[i] = {children[i].first,
+                             static_cast<uint16_t>(children[i].second),
+                             static_cast<uint8_t>(player)};
+    }
+  }
+  bool HasPendingChildren() const { return (m_state & PENDING) != 0; }
+  /* Number of children, including the pending ones that are not built yet */
+  size_t GetNMoves() const {
+    return HasPendingChildren() ? m_children_capacity : GetNChildren();
+  }
+  /* Move of the child at index, which may still be pending */
+  size_t GetChildMove(size_t index) const {
+    return HasPendingChildren() ? GetPendingChildren()[index].move
+                                : m_children[index].GetMove();
+  }
+  /* Builds the pending children up to index n, without making them visible:
+   * they can still be set up before PublishChildren(n) is called. Must be
+   * called with the node locked. */
+  void BuildPendingChildren(size_t n) {
+    const PendingChild* pending_children = GetPendingChildren();
+    for (size_t i = GetNChildren(); i < n; ++i) {
+      const PendingChild& pending_child = pending_children[i];
+      SearchNode* child =
+          new (&m_children[i]) SearchNode(pending_child.move,
+                                          pending_child.player, this,
+                                          pending_child.prior);
+      child->m_state = m_state & IN_ARENA;
+    }
+  }
+  void PublishChildren(size_t n) {
+    m_n_children.store(n, std::memory_order_release);
+  }
+
+  /* Detaches the child at index, which becomes the root of its own subtree,
+   * and frees all the other children of this node. The child keeps living in
+   * the children block of this node, which is only reclaimed with the arena:
+   * this node must therefore belong to an arena. If siblings is given, the
+   * other children are appended to it instead, to be freed later with
+   * FreeSubtree, possibly from another thread. */
+  SearchNode* DetachChild(size_t index,
+                          std::vector<SearchNode*>* siblings = nullptr) {
+    SearchNode* child = GetChild(index);
+    for (size_t i = 0; i != GetNChildren(); ++i) {
+      if (i == index) {
+        continue;
+      }
+      if (siblings != nullptr) {
+        siblings->push_back(&m_children[i]);
+      } else {
+        m_children[i].FreeSubtree();
+      }
+    }
+    child->SetParent(nullptr);
+    m_children = nullptr;
+    m_n_children = 0;
+    m_children_capacity = 0;
+    m_state.fetch_and(~(EXPANDED | PENDING));
+    return child;
+  }
+
+  /* Frees the whole subtree under this node */
+  void ClearChildren() { FreeChildren(); }
+
+  /* Frees the subtree under a node of an arena that is no longer reachable,
+   * along with its sharded statistics */
+  void FreeSubtree() {
+    FreeChildren();
+    ReleaseShardedStatistics();
+  }
+
+  /* The visit count and the accumulated value are packed in one atomic word,
+   * so that they are updated without locking and read consistently. */
+  size_t GetNVisits() const { return UnpackNVisits(GetMergedStatistics()); }
+  float GetAccumulatedValue() const {
+    return UnpackAccumulatedValue(GetMergedStatistics());
+  }
+  void GetStatistics(size_t* n_visits, float* accumulated_value) const {
+    uint64_t statistics = GetMergedStatistics();
+    *n_visits = UnpackNVisits(statistics);
+    *accumulated_value = UnpackAccumulatedValue(statistics);
+  }
+
+  void IncrementNVisits() {
+    GetStatisticsWord().fetch_add(1, std::memory_order_relaxed);
   }
-  SearchNode* GetChild(size_t index) { return m_children[index].get(); }
-  size_t GetNChildren() const { return m_children.size(); }
-  size_t GetNVisits() const { return m_n_visits; }
-  float GetAccumulatedValue() const { return m_acc_value; }
 
-  void IncrementNVisits() { ++m_n_visits; }
+  /* Spreads the statistics of this node over n_shards shards, each on its
+   * own cache line, so that threads updating the node do not contend on it.
+   * Worker i of a thread pool updates shard i; the last shard is shared by
+   * the other threads, so that a pool of n threads should use n + 1 shards.
+   * Reads merge the shards. Meant for the few nodes near the root that every
+   * simulation goes through, as shards take n_shards + 1 cache lines. Must
+   * be called before the node is shared between threads. */
+  void ShardStatistics(size_t n_shards) {
+    if (HasShardedStatistics() || n_shards == 0) {
+      return;
+    }
+    size_t size = GetShardedStatisticsSize(n_shards);
+    void* memory = IsInArena()
+                       ? oaz::arena::Arena::GetArena(this)->Allocate(size)
+                       : ::operator new(size);
+    auto* shards = static_cast<StatisticsShard*>(memory);
+    for (size_t i = 0; i != n_shards + 1; ++i) {
+      new (&shards[i]) StatisticsShard();
+    }
+    shards[0].statistics = n_shards;
+    shards[1].statistics = m_statistics.load();
+    m_statistics = reinterpret_cast<uintptr_t>(shards);
+    m_state.fetch_or(SHARDED);
+  }
+  bool HasShardedStatistics() const {
+    return (m_state.load(std::memory_order_relaxed) & SHARDED) != 0;
+  }
+
+  void Lock() {
+    while (m_state.fetch_or(LOCKED, std::memory_order_acquire) & LOCKED) {
+    }
+  }
 
-  void Lock() { m_mutex.Lock(); }
+  void Unlock() { m_state.fetch_and(~LOCKED, std::memory_order_release); }
 
-  void Unlock() { m_mutex.Unlock(); }
+  bool IsBlockedForEvaluation() const {
+    return (m_state & BLOCKED_FOR_EVALUATION) != 0;
+  }
 
-  bool IsBlockedForEvaluation() const { return m_is_blocked_for_evaluation; }
+  void BlockForEvaluation() { m_state.fetch_or(BLOCKED_FOR_EVALUATION); }
 
-  void BlockForEvaluation() { m_is_blocked_for_evaluation = true; }
+  void UnblockForEvaluation() { m_state.fetch_and(~BLOCKED_FOR_EVALUATION); }
 
-  void UnblockForEvaluation() { m_is_blocked_for_evaluation = false; }
+  /* Selections paused on a leaf blocked for evaluation are chained through
+   * the slots of their search, so that the expansion of the leaf resumes
+   * exactly them. The node only holds the first slot of the chain, plus one:
+   * 0 stands for an empty chain. Must be accessed with the node locked. */
+  static constexpr size_t MAX_N_WAITERS = UINT16_MAX;
+  size_t GetFirstWaiter() const { return m_first_waiter; }
+  void SetFirstWaiter(size_t first_waiter) {
+    m_first_waiter = static_cast<uint16_t>(first_waiter);
+  }
 
-  void AddValue(float value) { m_acc_value += value; }
+  void AddValue(float value) {
+    std::atomic<uint64_t>& word = GetStatisticsWord();
+    uint64_t statistics = word.load(std::memory_order_relaxed);
+    while (!word.compare_exchange_weak(
+        statistics,
+        PackStatistics(UnpackNVisits(statistics),
+                       UnpackAccumulatedValue(statistics) + value),
+        std::memory_order_relaxed)) {
+    }
+  }
 
   SearchNode* GetParent() { return m_parent; }
 
@@ -98,7 +374,7 @@ class SearchNode {
 
   class CPriorIterator : public std::iterator<std::input_iterator_tag, const float, void, const float*, const float&>
 {
-    public: 
+    public:
 
       CPriorIterator(SearchNode* search_node, size_t child_index): m_search_node(search_node), m_child_index(child_index) {}
 
@@ -120,17 +396,172 @@ class SearchNode {
   CPriorIterator GetPriorCEnd() { return CPriorIterator(this, GetNChildren()); }
 
  private:
+  // Bits of the state word
+  static constexpr uint16_t LOCKED = 1;
+  static constexpr uint16_t BLOCKED_FOR_EVALUATION = 1 << 1;
+  static constexpr uint16_t IN_ARENA = 1 << 2;
+  static constexpr uint16_t EXPANDED = 1 << 3;
+  // The statistics word then points to ShardedStatistics
+  static constexpr uint16_t SHARDED = 1 << 4;
+  // The children pointer then points to the target of the alias
+  static constexpr uint16_t ALIAS = 1 << 5;
+  // Two bits holding the ProvenValue
+  static constexpr uint16_t PROVEN_SHIFT = 6;
+  static constexpr uint16_t PROVEN = 3 << PROVEN_SHIFT;
+  // The children block is then followed by the PendingChild of every child
+  static constexpr uint16_t PENDING = 1 << 8;
+
+  struct PendingChild {
+    float prior;
+    uint16_t move;
+    uint8_t player;
+  };
+
+  // Layout of the statistics word: visits in the low half, value in the high
+  static constexpr uint64_t N_VISITS_MASK = 0xFFFFFFFF;
+
+  static size_t UnpackNVisits(uint64_t statistics) {
+    return statistics & N_VISITS_MASK;
+  }
+  static float UnpackAccumulatedValue(uint64_t statistics) {
+    auto bits = static_cast<uint32_t>(statistics >> 32);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  static uint64_t PackStatistics(size_t n_visits, float accumulated_value) {
+    uint32_t bits;
+    std::memcpy(&bits, &accumulated_value, sizeof(bits));
+    return (static_cast<uint64_t>(bits) << 32) | (n_visits & N_VISITS_MASK);
+  }
+
+  // Shards are padded so that no two of them share a cache line. The first
+  // slot of sharded statistics holds the number of shards that follow it.
+  struct StatisticsShard {
+    std::atomic<uint64_t> statistics{0};
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  static size_t GetShardedStatisticsSize(size_t n_shards) {
+    return (n_shards + 1) * sizeof(StatisticsShard);
+  }
+
+  StatisticsShard* GetShards() const {
+    return reinterpret_cast<StatisticsShard*>(
+        static_cast<uintptr_t>(m_statistics.load(std::memory_order_relaxed)));
+  }
+
+  size_t GetNShards() const {
+    return GetShards()[0].statistics.load(std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t>& GetStatisticsWord() {
+    if (HasShardedStatistics()) {
+      size_t n_shards = GetNShards();
+      size_t worker_index = oaz::thread_pool::ThreadPool::GetWorkerIndex();
+      size_t shard = worker_index < n_shards ? worker_index : n_shards - 1;
+      return GetShards()[shard + 1].statistics;
+    }
+    return m_statistics;
+  }
+
+  uint64_t GetMergedStatistics() const {
+    if (!HasShardedStatistics()) {
+      return m_statistics.load(std::memory_order_relaxed);
+    }
+    size_t n_visits = 0;
+    float accumulated_value = 0.;
+    const StatisticsShard* shards = GetShards();
+    for (size_t i = 1; i != GetNShards() + 1; ++i) {
+      uint64_t statistics =
+          shards[i].statistics.load(std::memory_order_relaxed);
+      n_visits += UnpackNVisits(statistics);
+      accumulated_value += UnpackAccumulatedValue(statistics);
+    }
+    return PackStatistics(n_visits, accumulated_value);
+  }
+
+  /* Merges the shards back into the statistics word and frees them */
+  void ReleaseShardedStatistics() {
+    if (!HasShardedStatistics()) {
+      return;
+    }
+    StatisticsShard* shards = GetShards();
+    size_t size = GetShardedStatisticsSize(GetNShards());
+    uint64_t statistics = GetMergedStatistics();
+    if (IsInArena()) {
+      oaz::arena::Arena::GetArena(this)->Free(shards, size);
+    } else {
+      ::operator delete(shards);
+    }
+    m_statistics = statistics;
+    m_state.fetch_and(~SHARDED);
+  }
+
   void SetParent(SearchNode* parent) { m_parent = parent; }
 
-  std::vector<std::unique_ptr<SearchNode>> m_children;
+  static size_t GetChildrenBlockSize(size_t n, bool pending) {
+    return n * (sizeof(SearchNode) + (pending ? sizeof(PendingChild) : 0));
+  }
+
+  PendingChild* GetPendingChildren() const {
+    return reinterpret_cast<PendingChild*>(m_children + m_children_capacity);
+  }
+
+  SearchNode* AllocateChildren(size_t n, bool pending) {
+    size_t size = GetChildrenBlockSize(n, pending);
+    if (IsInArena()) {
+      return static_cast<SearchNode*>(
+          oaz::arena::Arena::GetArena(this)->Allocate(size));
+    }
+    return static_cast<SearchNode*>(::operator new(size));
+  }
+
+  void ReleaseChildrenBlock() {
+    if (m_children == nullptr) {
+      return;
+    }
+    if (IsInArena()) {
+      oaz::arena::Arena::GetArena(this)->Free(
+          m_children,
+          GetChildrenBlockSize(m_children_capacity, HasPendingChildren()));
+    } else {
+      ::operator delete(m_children);
+    }
+  }
+
+  void FreeChildren() {
+    if (IsAlias()) {
+      ClearAlias();
+      return;
+    }
+    for (size_t i = 0; i != GetNChildren(); ++i) {
+      if (IsInArena()) {
+        m_children[i].FreeChildren();
+        m_children[i].ReleaseShardedStatistics();
+      } else {
+        m_children[i].~SearchNode();
+      }
+    }
+    ReleaseChildrenBlock();
+    m_children = nullptr;
+    m_n_children = 0;
+    m_children_capacity = 0;
+    m_state.fetch_and(~(EXPANDED | PENDING));
+  }
+
+  // Fields are ordered by size so that a node fits in 40 bytes: the head of
+  // the waiters takes the padding left at the end
   SearchNode* m_parent;
-  size_t m_player;
-  size_t m_move;
-  size_t m_n_visits;
-  float m_acc_value;
+  SearchNode* m_children;
+  std::atomic<uint64_t> m_statistics;
   float m_prior;
-  bool m_is_blocked_for_evaluation;
-  oaz::mutex::SpinlockMutex m_mutex;
+  uint16_t m_move;
+  std::atomic<uint16_t> m_n_children;
+  uint16_t m_children_capacity;
+  std::atomic<uint16_t> m_state;
+  uint8_t m_player;
+  uint16_t m_first_waiter;
 };
 }  // namespace oaz::mcts
 #endif  // OAZ_MCTS_SEARCH_NODE_HPP_
@@ -1,11 +1,15 @@
 #ifndef OAZ_MCTS_SELECTION_HPP_
 #define OAZ_MCTS_SELECTION_HPP_
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <memory>
 #include <random>
+#include <vector>
 
 #include "oaz/mcts/search_node.hpp"
+#include "oaz/mcts/selection_kernels.hpp"
 
 namespace oaz::mcts {
 
@@ -14,6 +18,9 @@ static constexpr float C_EXPLORATION = 1.4142;
 class Selector {
  public:
   virtual size_t operator()(oaz::mcts::SearchNode*) = 0;
+  /* Selects among the first n children of the node only, as progressive
+   * widening requires */
+  virtual size_t operator()(oaz::mcts::SearchNode*, size_t) = 0;
   virtual std::unique_ptr<Selector> Clone() const = 0;
 
   virtual ~Selector() {}
@@ -24,12 +31,27 @@ class Selector {
   Selector& operator=(Selector&&) = default;
 };
 
-class UCTSelector : public Selector {
+class UCTSelector final : public Selector {
  public:
+  /* With vectorised set, the scores of all children are computed at once
+   * with the widest SIMD instruction set supported by the CPU. */
+  explicit UCTSelector(bool vectorised = false)
+      : m_instruction_set(vectorised ? GetInstructionSet()
+                                     : InstructionSet::SCALAR) {}
   size_t operator()(oaz::mcts::SearchNode* node) override {
+    return (*this)(node, node->GetNChildren());
+  }
+  size_t operator()(oaz::mcts::SearchNode* node, size_t n_children) override {
+    if (m_instruction_set != InstructionSet::SCALAR) {
+      return SelectUCT(node, n_children, C_EXPLORATION, m_instruction_set);
+    }
     size_t best_child_index = 0;
-    float best_score = 0;
-    for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    float best_score = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i != n_children; ++i) {
+      // Nothing is left to learn about proven children
+      if (node->GetChild(i)->IsProven()) {
+        continue;
+      }
       float score = GetChildScore(node, node->GetChild(i));
       if (score > best_score) {
         best_score = score;
@@ -43,6 +65,8 @@ class UCTSelector : public Selector {
   }
 
  private:
+  InstructionSet m_instruction_set;
+
   static float GetChildScore(oaz::mcts::SearchNode* parent,
                              oaz::mcts::SearchNode* child) {
     float q = (child->GetNVisits() == 0)
@@ -56,12 +80,27 @@ class UCTSelector : public Selector {
   }
 };
 
-class AZSelector : public Selector {
+class AZSelector final : public Selector {
  public:
+  /* With vectorised set, the scores of all children are computed at once
+   * with the widest SIMD instruction set supported by the CPU. */
+  explicit AZSelector(bool vectorised = false)
+      : m_instruction_set(vectorised ? GetInstructionSet()
+                                     : InstructionSet::SCALAR) {}
   size_t operator()(oaz::mcts::SearchNode* node) override {
+    return (*this)(node, node->GetNChildren());
+  }
+  size_t operator()(oaz::mcts::SearchNode* node, size_t n_children) override {
+    if (m_instruction_set != InstructionSet::SCALAR) {
+      return SelectPUCT(node, n_children, C_EXPLORATION, m_instruction_set);
+    }
     size_t best_child_index = 0;
-    float best_score = 0;
-    for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    float best_score = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i != n_children; ++i) {
+      // Nothing is left to learn about proven children
+      if (node->GetChild(i)->IsProven()) {
+        continue;
+      }
       float score = GetChildScore(node, node->GetChild(i));
       if (score > best_score) {
         best_score = score;
@@ -75,6 +114,8 @@ class AZSelector : public Selector {
   }
 
  private:
+  InstructionSet m_instruction_set;
+
   static float GetChildScore(oaz::mcts::SearchNode* parent,
                              oaz::mcts::SearchNode* child) {
     float q = (child->GetNVisits() == 0)
@@ -87,12 +128,130 @@ class AZSelector : public Selector {
   }
 };
 
-class PriorSelector : public Selector {
+/* Selection of Gumbel AlphaZero (Danihelka et al., 2022). Children are
+ * scored by their log prior plus a transform of their completed value, which
+ * grows with the visits of the node so that values take over from priors as
+ * the search progresses. The selected child is the one whose share of the
+ * visits falls furthest behind the improved policy, the softmax of these
+ * scores. Used by the root player, it also turns on the Gumbel root of the
+ * search: see GumbelRoot. */
+class GumbelSelector final : public Selector {
+ public:
+  explicit GumbelSelector(size_t n_sampled_children = 16,
+                          float c_visit = 50., float c_scale = 1.)
+      : m_n_sampled_children(n_sampled_children),
+        m_c_visit(c_visit),
+        m_c_scale(c_scale) {}
+  size_t operator()(oaz::mcts::SearchNode* node) override {
+    return (*this)(node, node->GetNChildren());
+  }
+  size_t operator()(oaz::mcts::SearchNode* node, size_t n_children) override {
+    thread_local std::vector<float> policy;
+    GetImprovedPolicy(node, n_children, &policy);
+    size_t total_n_visits = 0;
+    for (size_t i = 0; i != n_children; ++i) {
+      total_n_visits += node->GetChild(i)->GetNVisits();
+    }
+    size_t best_child_index = 0;
+    float best_score = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i != n_children; ++i) {
+      // Nothing is left to learn about proven children
+      if (node->GetChild(i)->IsProven()) {
+        continue;
+      }
+      float score = policy[i] - static_cast<float>(
+                                    node->GetChild(i)->GetNVisits()) /
+                                    static_cast<float>(1 + total_n_visits);
+      if (score > best_score) {
+        best_score = score;
+        best_child_index = i;
+      }
+    }
+    return best_child_index;
+  }
+  std::unique_ptr<Selector> Clone() const override {
+    return std::make_unique<GumbelSelector>(*this);
+  }
+
+  size_t GetNSampledChildren() const { return m_n_sampled_children; }
+
+  /* Log prior plus transformed completed value of each of the first n
+   * children. Unvisited children are completed with the prior-weighted mean
+   * value of the visited ones. */
+  void GetScores(oaz::mcts::SearchNode* node, size_t n_children,
+                 std::vector<float>* scores) const {
+    scores->resize(n_children);
+    size_t max_n_visits = 0;
+    float weighted_value = 0.;
+    float total_weight = 0.;
+    size_t n_visited = 0;
+    float total_value = 0.;
+    for (size_t i = 0; i != n_children; ++i) {
+      SearchNode* child = node->GetChild(i);
+      size_t n_visits = 0;
+      float accumulated_value = 0.;
+      child->GetStatistics(&n_visits, &accumulated_value);
+      max_n_visits = std::max(max_n_visits, n_visits);
+      (*scores)[i] = n_visits == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                   : accumulated_value / n_visits;
+      if (n_visits != 0) {
+        weighted_value += child->GetPrior() * (*scores)[i];
+        total_weight += child->GetPrior();
+        total_value += (*scores)[i];
+        ++n_visited;
+      }
+    }
+    float mixed_value = 0.5;
+    if (total_weight > 0.) {
+      mixed_value = weighted_value / total_weight;
+    } else if (n_visited != 0) {
+      mixed_value = total_value / n_visited;
+    }
+    float scale = (m_c_visit + static_cast<float>(max_n_visits)) * m_c_scale;
+    for (size_t i = 0; i != n_children; ++i) {
+      float value = std::isnan((*scores)[i]) ? mixed_value : (*scores)[i];
+      (*scores)[i] = GetLogPrior(node->GetChild(i)) + scale * value;
+    }
+  }
+
+  void GetImprovedPolicy(oaz::mcts::SearchNode* node, size_t n_children,
+                         std::vector<float>* policy) const {
+    GetScores(node, n_children, policy);
+    if (n_children == 0) {
+      return;
+    }
+    float max_score = *std::max_element(policy->begin(), policy->end());
+    float total = 0.;
+    for (float& score : *policy) {
+      score = std::exp(score - max_score);
+      total += score;
+    }
+    for (float& score : *policy) {
+      score /= total;
+    }
+  }
+
+  static float GetLogPrior(oaz::mcts::SearchNode* child) {
+    static constexpr float MIN_PRIOR = 1e-30;
+    return std::log(std::max(child->GetPrior(), MIN_PRIOR));
+  }
+
+ private:
+  size_t m_n_sampled_children;
+  float m_c_visit;
+  float m_c_scale;
+};
+
+class PriorSelector final : public Selector {
   public:
     PriorSelector(): m_generator(0) {}
     PriorSelector(size_t seed): m_generator(seed) {}
     size_t operator()(oaz::mcts::SearchNode* node) override {
-      std::discrete_distribution<size_t> policy_distribution(node->GetPriorCBegin(), node->GetPriorCEnd());
+      return (*this)(node, node->GetNChildren());
+    }
+    size_t operator()(oaz::mcts::SearchNode* node, size_t n_children) override {
+      std::discrete_distribution<size_t> policy_distribution(
+          node->GetPriorCBegin(), SearchNode::CPriorIterator(node, n_children));
       return policy_distribution(m_generator);
     }
     std::unique_ptr<Selector> Clone() const override {
@@ -0,0 +1,313 @@
+#ifndef OAZ_MCTS_SELECTION_KERNELS_HPP_
+#define OAZ_MCTS_SELECTION_KERNELS_HPP_
+
+#include <stdint.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+  #define OAZ_X86_KERNELS
+  #include <immintrin.h>
+#endif
+
+#include "oaz/mcts/search_node.hpp"
+
+namespace oaz::mcts {
+
+enum class InstructionSet { SCALAR, AVX2, AVX512 };
+
+/* Widest instruction set supported by the CPU the process runs on */
+inline InstructionSet GetInstructionSet() {
+#ifdef OAZ_X86_KERNELS
+  static const InstructionSet instruction_set = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return InstructionSet::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return InstructionSet::AVX2;
+    }
+    return InstructionSet::SCALAR;
+  }();
+  return instruction_set;
+#else
+  return InstructionSet::SCALAR;
+#endif
+}
+
+/* Statistics of the children of an expanded node, laid out as a structure of
+ * arrays so that the scores of all children can be computed in SIMD lanes.
+ * Visit counts are stored as floats since they only feed into float
+ * arithmetic. */
+class ChildStatistics {
+ public:
+  void Load(SearchNode* node) { Load(node, node->GetNChildren()); }
+
+  /* Loads the first n_children children only */
+  void Load(SearchNode* node, size_t n_children) {
+    m_priors.resize(n_children);
+    m_n_visits.resize(n_children);
+    m_accumulated_values.resize(n_children);
+    m_scores.resize(n_children);
+    m_proven.clear();
+    for (size_t i = 0; i != n_children; ++i) {
+      SearchNode* child = node->GetChild(i);
+      size_t n_visits = 0;
+      m_priors[i] = child->GetPrior();
+      child->GetStatistics(&n_visits, &m_accumulated_values[i]);
+      m_n_visits[i] = static_cast<float>(n_visits);
+      if (child->IsProven()) {
+        m_proven.push_back(i);
+      }
+    }
+  }
+
+  /* Gives the proven children a score of minus infinity, so that they are
+   * only selected if all children are proven */
+  void ExcludeProven() {
+    for (size_t i : m_proven) {
+      m_scores[i] = -std::numeric_limits<float>::infinity();
+    }
+  }
+
+  size_t GetSize() const { return m_priors.size(); }
+  const float* GetPriors() const { return m_priors.data(); }
+  const float* GetNVisits() const { return m_n_visits.data(); }
+  const float* GetAccumulatedValues() const {
+    return m_accumulated_values.data();
+  }
+  float* GetScores() { return m_scores.data(); }
+
+ private:
+  std::vector<float> m_priors;
+  std::vector<float> m_n_visits;
+  std::vector<float> m_accumulated_values;
+  std::vector<float> m_scores;
+  std::vector<size_t> m_proven;
+};
+
+namespace kernels {
+
+/* All kernels compute, for each child i,
+ *   q_i + numerator_i * scale / (n_visits_i + 1)
+ * where q_i is the mean value of the child (0 if unvisited), and numerator_i
+ * is the prior of the child for PUCT and 1 for UCT. */
+
+inline void ComputeScoresScalar(size_t begin, size_t n,
+                                const float* n_visits,
+                                const float* accumulated_values,
+                                const float* priors, float scale,
+                                float* scores) {
+  for (size_t i = begin; i != n; ++i) {
+    float q = n_visits[i] == 0 ? 0 : accumulated_values[i] / n_visits[i];
+    float numerator = priors ? priors[i] * scale : scale;
+    scores[i] = q + numerator / (n_visits[i] + 1);
+  }
+}
+
+inline size_t ArgMaxScalar(size_t begin, size_t n, const float* scores,
+                           float* best_score) {
+  size_t best_index = 0;
+  for (size_t i = begin; i != n; ++i) {
+    if (scores[i] > *best_score) {
+      *best_score = scores[i];
+      best_index = i;
+    }
+  }
+  return best_index;
+}
+
+#ifdef OAZ_X86_KERNELS
+__attribute__((target("avx2"))) inline void ComputeScoresAVX2(
+    size_t n, const float* n_visits, const float* accumulated_values,
+    const float* priors, float scale, float* scores) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.);
+  const __m256 scale_vector = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 visits = _mm256_loadu_ps(n_visits + i);
+    __m256 values = _mm256_loadu_ps(accumulated_values + i);
+    __m256 q = _mm256_div_ps(values, visits);
+    q = _mm256_blendv_ps(q, zero, _mm256_cmp_ps(visits, zero, _CMP_EQ_OQ));
+    __m256 numerator =
+        priors ? _mm256_mul_ps(_mm256_loadu_ps(priors + i), scale_vector)
+               : scale_vector;
+    __m256 exploration =
+        _mm256_div_ps(numerator, _mm256_add_ps(visits, one));
+    _mm256_storeu_ps(scores + i, _mm256_add_ps(q, exploration));
+  }
+  ComputeScoresScalar(i, n, n_visits, accumulated_values, priors, scale,
+                      scores);
+}
+
+__attribute__((target("avx2"))) inline size_t ArgMaxAVX2(size_t n,
+                                                         const float* scores) {
+  const float lowest = -std::numeric_limits<float>::infinity();
+  __m256 maximum = _mm256_set1_ps(lowest);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    maximum = _mm256_max_ps(maximum, _mm256_loadu_ps(scores + i));
+  }
+  alignas(32) float lanes[8];
+  _mm256_store_ps(lanes, maximum);
+  float best_score = lowest;
+  for (float lane : lanes) {
+    best_score = lane > best_score ? lane : best_score;
+  }
+  for (; i != n; ++i) {
+    best_score = scores[i] > best_score ? scores[i] : best_score;
+  }
+  if (!(best_score > lowest)) {
+    return 0;
+  }
+  // First index holding the maximum, as the scalar selectors would return
+  const __m256 best = _mm256_set1_ps(best_score);
+  for (i = 0; i + 8 <= n; i += 8) {
+    int mask = _mm256_movemask_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(scores + i), best, _CMP_EQ_OQ));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  for (; i != n; ++i) {
+    if (scores[i] == best_score) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+__attribute__((target("avx512f"))) inline void ComputeScoresAVX512(
+    size_t n, const float* n_visits, const float* accumulated_values,
+    const float* priors, float scale, float* scores) {
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.);
+  const __m512 scale_vector = _mm512_set1_ps(scale);
+  size_t i = 0;
+  for (; i < n; i += 16) {
+    // The tail is handled with masked loads and stores
+    __mmask16 lanes = n - i >= 16 ? 0xFFFF : (1U << (n - i)) - 1;
+    __m512 visits = _mm512_maskz_loadu_ps(lanes, n_visits + i);
+    __m512 values = _mm512_maskz_loadu_ps(lanes, accumulated_values + i);
+    __mmask16 visited = _mm512_cmp_ps_mask(visits, zero, _CMP_NEQ_UQ);
+    __m512 q = _mm512_maskz_div_ps(visited, values, visits);
+    __m512 numerator =
+        priors ? _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, priors + i),
+                               scale_vector)
+               : scale_vector;
+    __m512 exploration =
+        _mm512_div_ps(numerator, _mm512_add_ps(visits, one));
+    _mm512_mask_storeu_ps(scores + i, lanes, _mm512_add_ps(q, exploration));
+  }
+}
+
+__attribute__((target("avx512f"))) inline size_t ArgMaxAVX512(
+    size_t n, const float* scores) {
+  const float lowest = -std::numeric_limits<float>::infinity();
+  __m512 maximum = _mm512_set1_ps(lowest);
+  for (size_t i = 0; i < n; i += 16) {
+    __mmask16 lanes = n - i >= 16 ? 0xFFFF : (1U << (n - i)) - 1;
+    maximum = _mm512_mask_max_ps(maximum, lanes, maximum,
+                                 _mm512_maskz_loadu_ps(lanes, scores + i));
+  }
+  // Reduced through memory, like in ArgMaxAVX2: the expansions of
+  // _mm512_reduce_max_ps and of the 512-bit extracts trip -Wuninitialized
+  // with GCC 12
+  alignas(64) float lanes[16];
+  _mm512_store_ps(lanes, maximum);
+  float best_score = lowest;
+  for (float lane : lanes) {
+    best_score = lane > best_score ? lane : best_score;
+  }
+  if (!(best_score > lowest)) {
+    return 0;
+  }
+  const __m512 best = _mm512_set1_ps(best_score);
+  for (size_t i = 0; i < n; i += 16) {
+    __mmask16 lanes = n - i >= 16 ? 0xFFFF : (1U << (n - i)) - 1;
+    __mmask16 mask = _mm512_mask_cmp_ps_mask(
+        lanes, _mm512_maskz_loadu_ps(lanes, scores + i), best, _CMP_EQ_OQ);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return 0;
+}
+#endif
+
+inline void ComputeScores(InstructionSet instruction_set, size_t n,
+                          const float* n_visits,
+                          const float* accumulated_values,
+                          const float* priors, float scale, float* scores) {
+#ifdef OAZ_X86_KERNELS
+  if (instruction_set == InstructionSet::AVX512) {
+    ComputeScoresAVX512(n, n_visits, accumulated_values, priors, scale,
+                        scores);
+    return;
+  }
+  if (instruction_set == InstructionSet::AVX2) {
+    ComputeScoresAVX2(n, n_visits, accumulated_values, priors, scale, scores);
+    return;
+  }
+#endif
+  ComputeScoresScalar(0, n, n_visits, accumulated_values, priors, scale,
+                      scores);
+}
+
+/* Index of the first maximal score, or 0 if all scores are minus infinity */
+inline size_t ArgMax(InstructionSet instruction_set, size_t n,
+                     const float* scores) {
+#ifdef OAZ_X86_KERNELS
+  if (instruction_set == InstructionSet::AVX512) {
+    return ArgMaxAVX512(n, scores);
+  }
+  if (instruction_set == InstructionSet::AVX2) {
+    return ArgMaxAVX2(n, scores);
+  }
+#endif
+  float best_score = -std::numeric_limits<float>::infinity();
+  return ArgMaxScalar(0, n, scores, &best_score);
+}
+}  // namespace kernels
+
+/* PUCT child selection over the statistics of the first n_children children
+ * at once */
+inline size_t SelectPUCT(SearchNode* node, size_t n_children,
+                         float c_exploration,
+                         InstructionSet instruction_set) {
+  static thread_local ChildStatistics statistics;
+  statistics.Load(node, n_children);
+  float scale =
+      c_exploration * static_cast<float>(std::sqrt(node->GetNVisits()));
+  kernels::ComputeScores(instruction_set, statistics.GetSize(),
+                         statistics.GetNVisits(),
+                         statistics.GetAccumulatedValues(),
+                         statistics.GetPriors(), scale,
+                         statistics.GetScores());
+  statistics.ExcludeProven();
+  return kernels::ArgMax(instruction_set, statistics.GetSize(),
+                         statistics.GetScores());
+}
+
+/* UCT child selection over the statistics of the first n_children children
+ * at once */
+inline size_t SelectUCT(SearchNode* node, size_t n_children,
+                        float c_exploration,
+                        InstructionSet instruction_set) {
+  static thread_local ChildStatistics statistics;
+  statistics.Load(node, n_children);
+  float scale = c_exploration * static_cast<float>(std::sqrt(
+                                    std::log(node->GetNVisits())));
+  kernels::ComputeScores(instruction_set, statistics.GetSize(),
+                         statistics.GetNVisits(),
+                         statistics.GetAccumulatedValues(), nullptr, scale,
+                         statistics.GetScores());
+  statistics.ExcludeProven();
+  return kernels::ArgMax(instruction_set, statistics.GetSize(),
+                         statistics.GetScores());
+}
+}  // namespace oaz::mcts
+#endif  // OAZ_MCTS_SELECTION_KERNELS_HPP_
@@ -0,0 +1,61 @@
+#ifndef OAZ_MCTS_TIME_ALLOCATION_HPP_
+#define OAZ_MCTS_TIME_ALLOCATION_HPP_
+
+#include <stdint.h>
+
+#include <algorithm>
+
+namespace oaz::mcts {
+
+/* Splits a player's clock between the moves of a game. Each move is given an
+ * equal share of the remaining time over the moves expected to remain, plus
+ * the increment, but never more than a fixed fraction of the remaining time,
+ * so that a game running longer than expected does not run out of time. All
+ * times are in seconds. */
+class TimeAllocator {
+ public:
+  static constexpr size_t MIN_N_MOVES_LEFT = 4;
+  static constexpr double MAX_FRACTION_PER_MOVE = 0.5;
+
+  TimeAllocator(double time_per_game, size_t expected_n_moves,
+                double increment = 0.)
+      : m_time_per_game(time_per_game),
+        m_expected_n_moves(expected_n_moves),
+        m_increment(increment),
+        m_remaining_time(time_per_game),
+        m_n_moves_played(0) {}
+
+  /* Starts the clock of a new game */
+  void Reset() {
+    m_remaining_time = m_time_per_game;
+    m_n_moves_played = 0;
+  }
+
+  /* Time to spend on the next move */
+  double GetMoveBudget() const {
+    size_t n_moves_left =
+        m_expected_n_moves > m_n_moves_played + MIN_N_MOVES_LEFT
+            ? m_expected_n_moves - m_n_moves_played
+            : MIN_N_MOVES_LEFT;
+    double budget = m_remaining_time / n_moves_left + m_increment;
+    return std::min(budget, MAX_FRACTION_PER_MOVE * m_remaining_time);
+  }
+
+  /* Records that a move was played in elapsed seconds */
+  void ConsumeTime(double elapsed) {
+    m_remaining_time = std::max(0., m_remaining_time - elapsed) + m_increment;
+    ++m_n_moves_played;
+  }
+
+  double GetRemainingTime() const { return m_remaining_time; }
+  size_t GetNMovesPlayed() const { return m_n_moves_played; }
+
+ private:
+  double m_time_per_game;
+  size_t m_expected_n_moves;
+  double m_increment;
+  double m_remaining_time;
+  size_t m_n_moves_played;
+};
+}  // namespace oaz::mcts
+#endif  // OAZ_MCTS_TIME_ALLOCATION_HPP_
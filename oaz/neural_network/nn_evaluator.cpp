@@ -64,6 +64,16 @@ size_t oaz::nn::EvaluationBatch::AcquireIndex() {
   return index;
 }
 
+/* Claims up to n consecutive indices, the first of which is written to
+ * first_index, and returns how many were claimed. */
+size_t oaz::nn::EvaluationBatch::AcquireIndices(size_t n,
+                                                size_t* first_index) {
+  size_t n_acquired = std::min(n, GetSize() - m_current_index);
+  *first_index = m_current_index;
+  m_current_index += n_acquired;
+  return n_acquired;
+}
+
 boost::multi_array_ref<oaz::games::Game*, 1>
 oaz::nn::EvaluationBatch::GetGames() {
   return boost::multi_array_ref<oaz::games::Game*, 1>(
@@ -158,7 +168,32 @@ void oaz::nn::NNEvaluator::RequestEvaluation(
   if (m_cache && EvaluateFromCache(game, evaluation, task)) {
     return;
   }
-  EvaluateFromNN(game, evaluation, task);
+  EvaluateFromNN(&game, &evaluation, &task, 1);
+}
+
+void oaz::nn::NNEvaluator::RequestEvaluations(
+    const std::vector<oaz::games::Game*>& games,
+    const std::vector<std::unique_ptr<oaz::evaluator::Evaluation>*>&
+        evaluations,
+    const std::vector<oaz::thread_pool::Task*>& tasks) {
+  if (!m_cache) {
+    EvaluateFromNN(games.data(), evaluations.data(), tasks.data(),
+                   games.size());
+    return;
+  }
+
+  std::vector<oaz::games::Game*> missed_games;
+  std::vector<std::unique_ptr<oaz::evaluator::Evaluation>*> missed_evaluations;
+  std::vector<oaz::thread_pool::Task*> missed_tasks;
+  for (size_t i = 0; i != games.size(); ++i) {
+    if (!EvaluateFromCache(games[i], evaluations[i], tasks[i])) {
+      missed_games.push_back(games[i]);
+      missed_evaluations.push_back(evaluations[i]);
+      missed_tasks.push_back(tasks[i]);
+    }
+  }
+  EvaluateFromNN(missed_games.data(), missed_evaluations.data(),
+                 missed_tasks.data(), missed_games.size());
 }
 
 bool oaz::nn::NNEvaluator::EvaluateFromCache(
@@ -172,16 +207,25 @@ bool oaz::nn::NNEvaluator::EvaluateFromCache(
   return success;
 }
 
+/* Requests are written to the current batch in runs: each pass claims as
+ * many indices as the batch has left under a single acquisition of the
+ * locks, so a batch of requests does not contend once per element. */
 void oaz::nn::NNEvaluator::EvaluateFromNN(
-    oaz::games::Game* game,
-    std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
-    oaz::thread_pool::Task* task) {
-  m_batches.Lock();
-  if (!m_batches.empty()) {
+    oaz::games::Game* const* games,
+    std::unique_ptr<oaz::evaluator::Evaluation>* const* evaluations,
+    oaz::thread_pool::Task* const* tasks, size_t n_requests) {
+  size_t n_acquired = 0;
+  while (n_acquired != n_requests) {
+    m_batches.Lock();
+    if (m_batches.empty()) {
+      AddNewBatch();
+    }
     auto current_batch = m_batches.back();
     current_batch->Lock();
 
-    size_t index = current_batch->AcquireIndex();
+    size_t index = 0;
+    size_t n_indices =
+        current_batch->AcquireIndices(n_requests - n_acquired, &index);
 
     bool evaluate_batch = current_batch->IsFull();
     if (evaluate_batch) {
@@ -191,19 +235,17 @@ void oaz::nn::NNEvaluator::EvaluateFromNN(
     current_batch->Unlock();
     m_batches.Unlock();
 
-    current_batch->InitialiseElement(index, game, evaluation, task);
+    for (size_t i = 0; i != n_indices; ++i, ++n_acquired) {
+      current_batch->InitialiseElement(index + i, games[n_acquired],
+                                       evaluations[n_acquired],
+                                       tasks[n_acquired]);
+    }
 
     if (evaluate_batch) {
       while (!current_batch->IsAvailableForEvaluation()) {
       }
       EvaluateBatch(current_batch.get());
     }
-
-  } else {
-    AddNewBatch();
-    m_batches.Unlock();
-
-    EvaluateFromNN(game, evaluation, task);
   }
 }
 
@@ -57,6 +57,7 @@ class EvaluationBatch {
   float* GetValue(size_t);
 
   size_t AcquireIndex();
+  size_t AcquireIndices(size_t, size_t*);
   void InitialiseElement(size_t, oaz::games::Game*,
 			 std::unique_ptr<oaz::evaluator::Evaluation>*, 
                          oaz::thread_pool::Task*);
@@ -114,6 +115,11 @@ class NNEvaluator : public oaz::evaluator::Evaluator {
   void RequestEvaluation(oaz::games::Game* game,
                          std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
                          oaz::thread_pool::Task* task) override;
+  void RequestEvaluations(
+      const std::vector<oaz::games::Game*>& games,
+      const std::vector<std::unique_ptr<oaz::evaluator::Evaluation>*>&
+          evaluations,
+      const std::vector<oaz::thread_pool::Task*>& tasks) override;
 
   std::vector<EvaluationBatchStatistics> GetStatistics();
 
@@ -128,9 +134,9 @@ class NNEvaluator : public oaz::evaluator::Evaluator {
   bool EvaluateFromCache(oaz::games::Game*,
 		  	 std::unique_ptr<oaz::evaluator::Evaluation>*,
                          oaz::thread_pool::Task*);
-  void EvaluateFromNN(oaz::games::Game*,
-		      std::unique_ptr<oaz::evaluator::Evaluation>*,
-                      oaz::thread_pool::Task*);
+  void EvaluateFromNN(oaz::games::Game* const*,
+                      std::unique_ptr<oaz::evaluator::Evaluation>* const*,
+                      oaz::thread_pool::Task* const*, size_t);
 
   size_t GetBatchSize() const;
   const std::vector<int>& GetElementDimensions() const;
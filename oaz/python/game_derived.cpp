@@ -71,6 +71,7 @@ BOOST_PYTHON_MODULE(MODULE_NAME) {  // NOLINT
 
   p::class_<GameImpl, p::bases<oaz::games::Game> >(XSTRINGIFY(GAME_CLASS_NAME))
       .def("play_move", &GameImpl::PlayMove)
+      .def("undo_move", &GameImpl::UndoMove)
       .def("from_numpy", &CreateGameFromNDArray)
       .staticmethod("from_numpy")
       .def("from_numpy_canonical", &CreateGameFromNDArrayCanonical)
@@ -79,6 +80,8 @@ BOOST_PYTHON_MODULE(MODULE_NAME) {  // NOLINT
       .add_property("finished", &GameImpl::IsFinished)
       .add_property("score", &GameImpl::GetScore)
       .add_property("available_moves", &GetAvailableMoves)
+      .add_property("mirror_symmetric", &GameImpl::IsMirrorSymmetric)
+      .def("get_mirror_move", &GameImpl::GetMirrorMove)
       .add_property("board", &GetBoard)
       .add_property("canonical_board", &GetCanonicalBoard);
 }
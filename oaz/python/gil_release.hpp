@@ -0,0 +1,25 @@
+#ifndef OAZ_PYTHON_GIL_RELEASE_HPP_
+#define OAZ_PYTHON_GIL_RELEASE_HPP_
+
+#include "Python.h"
+
+namespace oaz::python {
+
+/* Releases the GIL for the lifetime of the guard, so that blocking native
+ * calls let other Python threads run. The GIL is taken back when the guard
+ * goes out of scope, including when an exception is thrown, which must only
+ * then be translated for Python. */
+class GILRelease {
+ public:
+  GILRelease() : m_state(PyEval_SaveThread()) {}
+  ~GILRelease() { PyEval_RestoreThread(m_state); }
+  GILRelease(const GILRelease&) = delete;
+  GILRelease(GILRelease&&) = delete;
+  GILRelease& operator=(const GILRelease&) = delete;
+  GILRelease& operator=(GILRelease&&) = delete;
+
+ private:
+  PyThreadState* m_state;
+};
+}  // namespace oaz::python
+#endif  // OAZ_PYTHON_GIL_RELEASE_HPP_
@@ -1,6 +1,10 @@
 #include <vector>
 
+#include "oaz/mcts/multi_search.hpp"
 #include "oaz/mcts/search.hpp"
+#include "oaz/mcts/search_completion_queue.hpp"
+#include "oaz/mcts/time_allocation.hpp"
+#include "oaz/python/gil_release.hpp"
 
 #include <boost/python.hpp>
 #include <boost/python/def.hpp>
@@ -11,6 +15,89 @@
 namespace p = boost::python;
 
 namespace oaz::mcts {
+std::shared_ptr<SearchNode> CreateRoot(bool use_huge_pages) {
+  return SearchNode::CreateRoot(
+      std::make_shared<oaz::arena::Arena>(use_huge_pages));
+}
+
+std::shared_ptr<StopToken> GetStopToken(const SearchOptions& options) {
+  return options.stop_token;
+}
+
+void SetStopToken(SearchOptions& options,
+                  const std::shared_ptr<StopToken>& stop_token) {
+  options.stop_token = stop_token;
+}
+
+std::shared_ptr<oaz::reclaimer::Reclaimer> GetReclaimer(
+    const SearchOptions& options) {
+  return options.reclaimer;
+}
+
+void SetReclaimer(SearchOptions& options,
+                  const std::shared_ptr<oaz::reclaimer::Reclaimer>& reclaimer) {
+  options.reclaimer = reclaimer;
+}
+
+std::shared_ptr<NodeBudget> GetNodeBudget(const SearchOptions& options) {
+  return options.node_budget;
+}
+
+void SetNodeBudget(SearchOptions& options,
+                   const std::shared_ptr<NodeBudget>& node_budget) {
+  options.node_budget = node_budget;
+}
+
+void WaitForReclaimer(oaz::reclaimer::Reclaimer* reclaimer) {
+  oaz::python::GILRelease gil_release;
+  reclaimer->Wait();
+}
+
+std::shared_ptr<SearchNode> AdvanceRootInPlace(
+    const std::shared_ptr<SearchNode>& root, size_t move) {
+  return AdvanceRoot(root, move);
+}
+
+std::vector<PlayerSearchProperties> ExtractPlayerSearchProperties(
+    p::list& l_player_search_properties) {
+  std::vector<PlayerSearchProperties> player_search_properties;
+  for (int i = 0; i != p::len(l_player_search_properties); ++i) {
+    player_search_properties.push_back(p::extract<PlayerSearchProperties>(
+        l_player_search_properties[i]));
+  }
+  return player_search_properties;
+}
+
+/* Policy indexed by move, with folded moves split with their mirror moves */
+p::list UnfoldSearchPolicy(const Search& search, const p::object& l_policy) {
+  std::vector<float> policy;
+  for (int i = 0; i != p::len(l_policy); ++i) {
+    policy.push_back(p::extract<float>(l_policy[i]));
+  }
+  search.UnfoldPolicy(&policy);
+  p::list unfolded_policy;
+  for (float probability : policy) {
+    unfolded_policy.append(probability);
+  }
+  return unfolded_policy;
+}
+
+/* Returns the key of the next search to complete, or None if none completes
+ * within timeout seconds. A negative timeout waits indefinitely. */
+p::object PopCompletedSearch(SearchCompletionQueue& queue, double timeout) {
+  size_t key = 0;
+  bool popped = true;
+  {
+    oaz::python::GILRelease gil_release;
+    if (timeout < 0.) {
+      key = queue.Pop();
+    } else {
+      popped = queue.TryPop(&key, timeout);
+    }
+  }
+  return popped ? p::object(key) : p::object();
+}
+
 class SearchWrapper {
  public:
   SearchWrapper(
@@ -21,35 +108,219 @@ class SearchWrapper {
       float noise_alpha
 
       )
+      : SearchWrapper(game, l_player_search_properties, thread_pool,
+                      batch_size, n_iterations, noise_epsilon, noise_alpha,
+                      nullptr) {}
+
+  SearchWrapper(
+      const oaz::games::Game& game,
+      p::list& l_player_search_properties,
+      const std::shared_ptr<oaz::thread_pool::ThreadPool>& thread_pool,
+      size_t batch_size, size_t n_iterations, float noise_epsilon,
+      float noise_alpha, const std::shared_ptr<oaz::mcts::SearchNode>& root)
+      : SearchWrapper(game, l_player_search_properties, thread_pool,
+                      [&] {
+                        SearchOptions options;
+                        options.batch_size = batch_size;
+                        options.n_iterations = n_iterations;
+                        options.noise_epsilon = noise_epsilon;
+                        options.noise_alpha = noise_alpha;
+                        return options;
+                      }(),
+                      root) {}
+
+  SearchWrapper(
+      const oaz::games::Game& game,
+      p::list& l_player_search_properties,
+      const std::shared_ptr<oaz::thread_pool::ThreadPool>& thread_pool,
+      const SearchOptions& options,
+      const std::shared_ptr<oaz::mcts::SearchNode>& root)
       : m_search(nullptr) {
-    std::vector<oaz::mcts::PlayerSearchProperties> player_search_properties;
-    for(int i=0; i!=p::len(l_player_search_properties); ++i) {
-      player_search_properties.push_back(
-        p::extract<oaz::mcts::PlayerSearchProperties>(l_player_search_properties[i]));
-    }
-    PyThreadState* save_state = PyEval_SaveThread();
+    std::vector<oaz::mcts::PlayerSearchProperties> player_search_properties =
+        ExtractPlayerSearchProperties(l_player_search_properties);
+    oaz::python::GILRelease gil_release;
     m_search = std::make_shared<oaz::mcts::Search>(
-        game, player_search_properties, thread_pool, batch_size, n_iterations,
-        noise_epsilon, noise_alpha);
-    PyEval_RestoreThread(save_state);
+        game, player_search_properties, thread_pool, options, root);
+  }
+  void Reset(const oaz::games::Game& game, size_t n_iterations,
+             const std::shared_ptr<oaz::mcts::SearchNode>& root) {
+    oaz::python::GILRelease gil_release;
+    m_search->Reset(game, n_iterations, root);
+  }
+  std::shared_ptr<oaz::mcts::SearchNode> GetTreeRoot() {
+    return m_search->GetTreeRoot();
+  }
+  size_t GetNSavedIterations() const {
+    return m_search->GetNSavedIterations();
+  }
+  size_t GetNPrunings() const { return m_search->GetNPrunings(); }
+  bool HasGumbelRoot() const { return m_search->HasGumbelRoot(); }
+  size_t GetGumbelMove() const { return m_search->GetGumbelMove(); }
+  p::list GetImprovedPolicy() const {
+    p::list policy;
+    for (float probability : m_search->GetImprovedPolicy()) {
+      policy.append(probability);
+    }
+    return policy;
+  }
+  p::list GetFoldedMoves() const {
+    p::list folded_moves;
+    for (const auto& [move, mirror_move] : m_search->GetFoldedMoves()) {
+      folded_moves.append(p::make_tuple(move, mirror_move));
+    }
+    return folded_moves;
+  }
+  p::list UnfoldPolicy(const p::object& l_policy) const {
+    return UnfoldSearchPolicy(*m_search, l_policy);
   }
+
+ private:
+  std::shared_ptr<oaz::mcts::Search> m_search;
+};
+
+/* Search that runs in the background. If a queue is given, the key is pushed
+ * to it once the search is done. */
+class AsyncSearchWrapper {
+ public:
+  AsyncSearchWrapper(
+      const oaz::games::Game& game, p::list& l_player_search_properties,
+      const std::shared_ptr<oaz::thread_pool::ThreadPool>& thread_pool,
+      const SearchOptions& options,
+      const std::shared_ptr<oaz::mcts::SearchNode>& root,
+      const std::shared_ptr<SearchCompletionQueue>& queue, size_t key)
+      : m_search(nullptr), m_queue(queue), m_key(key) {
+    std::vector<oaz::mcts::PlayerSearchProperties> player_search_properties =
+        ExtractPlayerSearchProperties(l_player_search_properties);
+    oaz::python::GILRelease gil_release;
+    m_search = oaz::mcts::Search::Launch(game, player_search_properties,
+                                         thread_pool, options, root,
+                                         CreateCallback());
+  }
+
+  ~AsyncSearchWrapper() {
+    // The search is only destroyed once done, as it may hold the last
+    // reference to Python objects
+    Stop();
+    Wait();
+  }
+
+  void Stop() { m_search->Stop(); }
+
+  /* Pushes the key of the search to its queue again once done */
+  void Relaunch(const oaz::games::Game& game, size_t n_iterations,
+                const std::shared_ptr<oaz::mcts::SearchNode>& root) {
+    m_search->Relaunch(game, n_iterations, root, CreateCallback());
+  }
+
+  bool IsDone() const { return m_search->IsDone(); }
+
+  void Wait() {
+    oaz::python::GILRelease gil_release;
+    m_search->Wait();
+  }
+
   std::shared_ptr<oaz::mcts::SearchNode> GetTreeRoot() {
     return m_search->GetTreeRoot();
   }
+  size_t GetNSavedIterations() const {
+    return m_search->GetNSavedIterations();
+  }
+  size_t GetNPrunings() const { return m_search->GetNPrunings(); }
+  bool HasGumbelRoot() const { return m_search->HasGumbelRoot(); }
+  size_t GetGumbelMove() const { return m_search->GetGumbelMove(); }
+  p::list GetImprovedPolicy() const {
+    p::list policy;
+    for (float probability : m_search->GetImprovedPolicy()) {
+      policy.append(probability);
+    }
+    return policy;
+  }
+  p::list GetFoldedMoves() const {
+    p::list folded_moves;
+    for (const auto& [move, mirror_move] : m_search->GetFoldedMoves()) {
+      folded_moves.append(p::make_tuple(move, mirror_move));
+    }
+    return folded_moves;
+  }
+  p::list UnfoldPolicy(const p::object& l_policy) const {
+    return UnfoldSearchPolicy(*m_search, l_policy);
+  }
 
  private:
+  std::function<void()> CreateCallback() const {
+    if (!m_queue) {
+      return nullptr;
+    }
+    return [queue = m_queue, key = m_key] { queue->Push(key); };
+  }
+
   std::shared_ptr<oaz::mcts::Search> m_search;
+  std::shared_ptr<SearchCompletionQueue> m_queue;
+  size_t m_key;
+};
+
+/* Searches all the given games at once, without holding the GIL. Roots may
+ * be None, or hold a root or None per game. */
+class MultiSearchWrapper {
+ public:
+  MultiSearchWrapper(
+      p::list& l_games, p::list& l_player_search_properties,
+      const std::shared_ptr<oaz::thread_pool::ThreadPool>& thread_pool,
+      const SearchOptions& options, size_t n_concurrent_searches,
+      const p::object& l_roots)
+      : m_search(nullptr) {
+    std::vector<const oaz::games::Game*> games;
+    for (int i = 0; i != p::len(l_games); ++i) {
+      games.push_back(&p::extract<const oaz::games::Game&>(l_games[i])());
+    }
+    std::vector<oaz::mcts::PlayerSearchProperties> player_search_properties =
+        ExtractPlayerSearchProperties(l_player_search_properties);
+    std::vector<std::shared_ptr<oaz::mcts::SearchNode>> roots;
+    if (!l_roots.is_none()) {
+      for (int i = 0; i != p::len(l_roots); ++i) {
+        roots.push_back(
+            p::extract<std::shared_ptr<oaz::mcts::SearchNode>>(l_roots[i]));
+      }
+    }
+    oaz::python::GILRelease gil_release;
+    m_search = std::make_unique<MultiSearch>(games, player_search_properties,
+                                             thread_pool, options,
+                                             n_concurrent_searches, roots);
+  }
+
+  size_t GetNSearches() const { return m_search->GetNSearches(); }
+  std::shared_ptr<oaz::mcts::SearchNode> GetTreeRoot(size_t index) {
+    return m_search->GetTreeRoot(index);
+  }
+  p::list GetVisits(size_t index, size_t n_moves) {
+    p::list n_visits;
+    for (size_t n : m_search->GetVisits(index, n_moves)) {
+      n_visits.append(n);
+    }
+    return n_visits;
+  }
+
+ private:
+  std::unique_ptr<MultiSearch> m_search;
 };
 }  // namespace oaz::mcts
 
 BOOST_PYTHON_MODULE(search) {  // NOLINT
   PyEval_InitThreads();
 
+  p::enum_<oaz::mcts::ProvenValue>("ProvenValue")
+      .value("UNKNOWN", oaz::mcts::ProvenValue::UNKNOWN)
+      .value("LOSS", oaz::mcts::ProvenValue::LOSS)
+      .value("DRAW", oaz::mcts::ProvenValue::DRAW)
+      .value("WIN", oaz::mcts::ProvenValue::WIN);
+
   p::class_<oaz::mcts::SearchNode, std::shared_ptr<oaz::mcts::SearchNode>,
             boost::noncopyable>("SearchNode", p::init<>())
       .add_property("move", &oaz::mcts::SearchNode::GetMove)
       .add_property("is_root", &oaz::mcts::SearchNode::IsRoot)
       .add_property("is_leaf", &oaz::mcts::SearchNode::IsLeaf)
+      .add_property("is_alias", &oaz::mcts::SearchNode::IsAlias)
+      .add_property("proven", &oaz::mcts::SearchNode::GetProvenValue)
       .add_property("n_children", &oaz::mcts::SearchNode::GetNChildren)
       .add_property("n_visits", &oaz::mcts::SearchNode::GetNVisits)
       .add_property("accumulated_value",
@@ -64,11 +335,137 @@ BOOST_PYTHON_MODULE(search) {  // NOLINT
 	p::init<const std::shared_ptr<oaz::evaluator::Evaluator>, const std::shared_ptr<oaz::mcts::Selector>&>()
  );
 
+  p::class_<oaz::mcts::SearchOptions>("SearchOptions")
+      .def_readwrite("batch_size", &oaz::mcts::SearchOptions::batch_size)
+      .def_readwrite("n_iterations", &oaz::mcts::SearchOptions::n_iterations)
+      .def_readwrite("noise_epsilon",
+                     &oaz::mcts::SearchOptions::noise_epsilon)
+      .def_readwrite("noise_alpha", &oaz::mcts::SearchOptions::noise_alpha)
+      .def_readwrite("virtual_loss", &oaz::mcts::SearchOptions::virtual_loss)
+      .def_readwrite("n_sharded_levels",
+                     &oaz::mcts::SearchOptions::n_sharded_levels)
+      .def_readwrite("time_budget", &oaz::mcts::SearchOptions::time_budget)
+      .def_readwrite("use_transpositions",
+                     &oaz::mcts::SearchOptions::use_transpositions)
+      .def_readwrite("use_solver", &oaz::mcts::SearchOptions::use_solver)
+      .def_readwrite("stop_when_decided",
+                     &oaz::mcts::SearchOptions::stop_when_decided)
+      .def_readwrite("widening_constant",
+                     &oaz::mcts::SearchOptions::widening_constant)
+      .def_readwrite("widening_exponent",
+                     &oaz::mcts::SearchOptions::widening_exponent)
+      .def_readwrite("n_leaves_per_task",
+                     &oaz::mcts::SearchOptions::n_leaves_per_task)
+      .add_property("stop_token", &oaz::mcts::GetStopToken,
+                    &oaz::mcts::SetStopToken)
+      .add_property("reclaimer", &oaz::mcts::GetReclaimer,
+                    &oaz::mcts::SetReclaimer)
+      .def_readwrite("max_n_nodes", &oaz::mcts::SearchOptions::max_n_nodes)
+      .add_property("node_budget", &oaz::mcts::GetNodeBudget,
+                    &oaz::mcts::SetNodeBudget)
+      .def_readwrite("fold_symmetries",
+                     &oaz::mcts::SearchOptions::fold_symmetries);
+
+  p::class_<oaz::mcts::NodeBudget, std::shared_ptr<oaz::mcts::NodeBudget>,
+            boost::noncopyable>("NodeBudget", p::init<size_t>())
+      .add_property("n_nodes", &oaz::mcts::NodeBudget::GetNNodes)
+      .add_property("max_n_nodes", &oaz::mcts::NodeBudget::GetMaxNNodes);
+
+  p::class_<oaz::reclaimer::Reclaimer,
+            std::shared_ptr<oaz::reclaimer::Reclaimer>, boost::noncopyable>(
+      "Reclaimer")
+      .def("wait", &oaz::mcts::WaitForReclaimer)
+      .add_property("n_pending_jobs",
+                    &oaz::reclaimer::Reclaimer::GetNPendingJobs);
+
+  p::class_<oaz::mcts::StopToken, std::shared_ptr<oaz::mcts::StopToken>,
+            boost::noncopyable>("StopToken")
+      .def("stop", &oaz::mcts::StopToken::Stop)
+      .def("reset", &oaz::mcts::StopToken::Reset)
+      .add_property("stopped", &oaz::mcts::StopToken::IsStopped);
+
+  p::class_<oaz::mcts::TimeAllocator>(
+      "TimeAllocator", p::init<double, size_t, p::optional<double> >())
+      .def("reset", &oaz::mcts::TimeAllocator::Reset)
+      .def("get_move_budget", &oaz::mcts::TimeAllocator::GetMoveBudget)
+      .def("consume_time", &oaz::mcts::TimeAllocator::ConsumeTime)
+      .add_property("remaining_time",
+                    &oaz::mcts::TimeAllocator::GetRemainingTime)
+      .add_property("n_moves_played",
+                    &oaz::mcts::TimeAllocator::GetNMovesPlayed);
+
   p::class_<oaz::mcts::SearchWrapper, std::shared_ptr<oaz::mcts::SearchWrapper>,
             boost::noncopyable>(
       "Search", p::init<const oaz::games::Game&,
       			p::list&,
                         std::shared_ptr<oaz::thread_pool::ThreadPool>, size_t,
                         size_t, float, float>())
-      .def("get_tree_root", &oaz::mcts::SearchWrapper::GetTreeRoot);
+      .def(p::init<const oaz::games::Game&, p::list&,
+                   std::shared_ptr<oaz::thread_pool::ThreadPool>, size_t,
+                   size_t, float, float,
+                   std::shared_ptr<oaz::mcts::SearchNode>>())
+      .def(p::init<const oaz::games::Game&, p::list&,
+                   std::shared_ptr<oaz::thread_pool::ThreadPool>,
+                   const oaz::mcts::SearchOptions&,
+                   std::shared_ptr<oaz::mcts::SearchNode>>())
+      .def("reset", &oaz::mcts::SearchWrapper::Reset)
+      .def("get_tree_root", &oaz::mcts::SearchWrapper::GetTreeRoot)
+      .add_property("n_saved_iterations",
+                    &oaz::mcts::SearchWrapper::GetNSavedIterations)
+      .add_property("n_prunings", &oaz::mcts::SearchWrapper::GetNPrunings)
+      .add_property("has_gumbel_root",
+                    &oaz::mcts::SearchWrapper::HasGumbelRoot)
+      .add_property("gumbel_move", &oaz::mcts::SearchWrapper::GetGumbelMove)
+      .def("get_improved_policy",
+           &oaz::mcts::SearchWrapper::GetImprovedPolicy)
+      .def("get_folded_moves", &oaz::mcts::SearchWrapper::GetFoldedMoves)
+      .def("unfold_policy", &oaz::mcts::SearchWrapper::UnfoldPolicy);
+
+  p::class_<oaz::mcts::SearchCompletionQueue,
+            std::shared_ptr<oaz::mcts::SearchCompletionQueue>,
+            boost::noncopyable>("SearchCompletionQueue")
+      .def("push", &oaz::mcts::SearchCompletionQueue::Push)
+      .def("pop", &oaz::mcts::PopCompletedSearch)
+      .add_property("size", &oaz::mcts::SearchCompletionQueue::GetSize);
+
+  p::class_<oaz::mcts::AsyncSearchWrapper,
+            std::shared_ptr<oaz::mcts::AsyncSearchWrapper>,
+            boost::noncopyable>(
+      "AsyncSearch",
+      p::init<const oaz::games::Game&, p::list&,
+              std::shared_ptr<oaz::thread_pool::ThreadPool>,
+              const oaz::mcts::SearchOptions&,
+              std::shared_ptr<oaz::mcts::SearchNode>,
+              std::shared_ptr<oaz::mcts::SearchCompletionQueue>, size_t>())
+      .add_property("done", &oaz::mcts::AsyncSearchWrapper::IsDone)
+      .def("wait", &oaz::mcts::AsyncSearchWrapper::Wait)
+      .def("stop", &oaz::mcts::AsyncSearchWrapper::Stop)
+      .def("relaunch", &oaz::mcts::AsyncSearchWrapper::Relaunch)
+      .def("get_tree_root", &oaz::mcts::AsyncSearchWrapper::GetTreeRoot)
+      .add_property("n_saved_iterations",
+                    &oaz::mcts::AsyncSearchWrapper::GetNSavedIterations)
+      .add_property("n_prunings",
+                    &oaz::mcts::AsyncSearchWrapper::GetNPrunings)
+      .add_property("has_gumbel_root",
+                    &oaz::mcts::AsyncSearchWrapper::HasGumbelRoot)
+      .add_property("gumbel_move",
+                    &oaz::mcts::AsyncSearchWrapper::GetGumbelMove)
+      .def("get_improved_policy",
+           &oaz::mcts::AsyncSearchWrapper::GetImprovedPolicy)
+      .def("get_folded_moves",
+           &oaz::mcts::AsyncSearchWrapper::GetFoldedMoves)
+      .def("unfold_policy", &oaz::mcts::AsyncSearchWrapper::UnfoldPolicy);
+
+  p::class_<oaz::mcts::MultiSearchWrapper, boost::noncopyable>(
+      "MultiSearch",
+      p::init<p::list&, p::list&,
+              std::shared_ptr<oaz::thread_pool::ThreadPool>,
+              const oaz::mcts::SearchOptions&, size_t, p::object>())
+      .add_property("n_searches", &oaz::mcts::MultiSearchWrapper::GetNSearches)
+      .def("get_tree_root", &oaz::mcts::MultiSearchWrapper::GetTreeRoot)
+      .def("get_visits", &oaz::mcts::MultiSearchWrapper::GetVisits);
+
+  p::def("advance_root", &oaz::mcts::AdvanceRootInPlace);
+  p::def("advance_root", &oaz::mcts::AdvanceRoot);
+  p::def("create_root", &oaz::mcts::CreateRoot);
 }
@@ -14,7 +14,9 @@ BOOST_PYTHON_MODULE(selection) {  // NOLINT
   p::class_<oaz::mcts::Selector, boost::noncopyable>("Selector", p::no_init);
 
   p::class_<oaz::mcts::UCTSelector, p::bases<oaz::mcts::Selector> >(
-      "UCTSelector");
+      "UCTSelector", p::init<p::optional<bool> >());
   p::class_<oaz::mcts::AZSelector, p::bases<oaz::mcts::Selector> >(
-      "AZSelector");
+      "AZSelector", p::init<p::optional<bool> >());
+  p::class_<oaz::mcts::GumbelSelector, p::bases<oaz::mcts::Selector> >(
+      "GumbelSelector", p::init<p::optional<size_t, float, float> >());
 }
@@ -0,0 +1,95 @@
+#include <cstring>
+#include <vector>
+
+#include "oaz/python/gil_release.hpp"
+#include "oaz/self_play/self_play.hpp"
+
+#include <boost/python.hpp>
+#include <boost/python/def.hpp>
+#include <boost/python/module.hpp>
+#include <boost/python/numpy.hpp>
+
+#include "Python.h"
+
+namespace p = boost::python;
+namespace np = boost::python::numpy;
+
+namespace oaz::self_play {
+
+std::shared_ptr<SelfPlay> ConstructSelfPlay(
+    p::list& l_player_search_properties,
+    const std::shared_ptr<oaz::thread_pool::ThreadPool>& thread_pool,
+    const SelfPlayOptions& options) {
+  std::vector<oaz::mcts::PlayerSearchProperties> player_search_properties;
+  for (int i = 0; i != p::len(l_player_search_properties); ++i) {
+    player_search_properties.push_back(
+        p::extract<oaz::mcts::PlayerSearchProperties>(
+            l_player_search_properties[i]));
+  }
+  return std::make_shared<SelfPlay>(player_search_properties, thread_pool,
+                                    options);
+}
+
+void Play(SelfPlay* self_play, p::list& l_games) {
+  std::vector<const oaz::games::Game*> games;
+  for (int i = 0; i != p::len(l_games); ++i) {
+    games.push_back(&p::extract<const oaz::games::Game&>(l_games[i])());
+  }
+  oaz::python::GILRelease gil_release;
+  self_play->Play(games);
+}
+
+np::ndarray ToNDArray(const std::vector<float>& data, p::list shape) {
+  np::ndarray array =
+      np::zeros(p::tuple(shape), np::dtype::get_builtin<float>());
+  std::memcpy(array.get_data(), data.data(), data.size() * sizeof(float));
+  return array;
+}
+
+/* Returns the positions played so far, in the format of the datasets of the
+ * Python self-play */
+p::dict GetDataset(const SelfPlay& self_play) {
+  size_t n_positions = self_play.GetNPositions();
+  p::list board_shape;
+  board_shape.append(n_positions);
+  for (int dimension : self_play.GetBoardShape()) {
+    board_shape.append(dimension);
+  }
+  p::list policy_shape;
+  policy_shape.append(n_positions);
+  policy_shape.append(self_play.GetPolicySize());
+  p::list value_shape;
+  value_shape.append(n_positions);
+
+  p::dict dataset;
+  dataset["Boards"] = ToNDArray(self_play.GetBoards(), board_shape);
+  dataset["Policies"] = ToNDArray(self_play.GetPolicies(), policy_shape);
+  dataset["Values"] = ToNDArray(self_play.GetValues(), value_shape);
+  return dataset;
+}
+}  // namespace oaz::self_play
+
+BOOST_PYTHON_MODULE(self_play_engine) {  // NOLINT
+  PyEval_InitThreads();
+  np::initialize();
+
+  p::class_<oaz::self_play::SelfPlayOptions>("SelfPlayOptions")
+      .def_readwrite("n_concurrent_games",
+                     &oaz::self_play::SelfPlayOptions::n_concurrent_games)
+      .def_readwrite("search_options",
+                     &oaz::self_play::SelfPlayOptions::search_options)
+      .def_readwrite("temperature",
+                     &oaz::self_play::SelfPlayOptions::temperature)
+      .def_readwrite("discount_factor",
+                     &oaz::self_play::SelfPlayOptions::discount_factor)
+      .def_readwrite("reuse_tree", &oaz::self_play::SelfPlayOptions::reuse_tree);
+
+  p::class_<oaz::self_play::SelfPlay,
+            std::shared_ptr<oaz::self_play::SelfPlay>, boost::noncopyable>(
+      "SelfPlay", p::no_init)
+      .def("__init__", p::make_constructor(&oaz::self_play::ConstructSelfPlay))
+      .def("play", &oaz::self_play::Play)
+      .def("clear", &oaz::self_play::SelfPlay::Clear)
+      .def("get_dataset", &oaz::self_play::GetDataset)
+      .add_property("n_positions", &oaz::self_play::SelfPlay::GetNPositions);
+}
@@ -0,0 +1,117 @@
+#ifndef OAZ_RECLAIMER_RECLAIMER_HPP_
+#define OAZ_RECLAIMER_RECLAIMER_HPP_
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+
+namespace oaz::reclaimer {
+
+/* Runs deallocations on a background thread of the lowest priority, so that
+ * the threads releasing large structures such as search trees do not wait
+ * for them to be freed. Jobs run one at a time, in the order they were
+ * deferred. The destructor waits for the pending jobs. */
+class Reclaimer {
+ public:
+  Reclaimer();
+  ~Reclaimer();
+  Reclaimer(const Reclaimer&) = delete;
+  Reclaimer(Reclaimer&&) = delete;
+  Reclaimer& operator=(const Reclaimer&) = delete;
+  Reclaimer& operator=(Reclaimer&&) = delete;
+
+  void Defer(std::function<void()> job);
+
+  /* Drops the reference on the background thread, so that the object is
+   * destroyed there if no other reference is left */
+  template <class T>
+  void Release(std::shared_ptr<T> pointer) {
+    if (pointer) {
+      Defer([pointer = std::move(pointer)]() mutable { pointer.reset(); });
+    }
+  }
+
+  /* Blocks until all the jobs deferred so far have run */
+  void Wait();
+  size_t GetNPendingJobs();
+
+ private:
+  void Run();
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::condition_variable m_idle_condition;
+  std::queue<std::function<void()>> m_jobs;
+  size_t m_n_running_jobs;
+  bool m_stop;
+  std::thread m_thread;
+};
+
+inline Reclaimer::Reclaimer()
+    : m_n_running_jobs(0), m_stop(false), m_thread([this] { Run(); }) {}
+
+inline Reclaimer::~Reclaimer() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_one();
+  m_thread.join();
+}
+
+inline void Reclaimer::Defer(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push(std::move(job));
+  }
+  m_condition.notify_one();
+}
+
+inline void Reclaimer::Wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle_condition.wait(
+      lock, [this] { return m_jobs.empty() && m_n_running_jobs == 0; });
+}
+
+inline size_t Reclaimer::GetNPendingJobs() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_jobs.size() + m_n_running_jobs;
+}
+
+inline void Reclaimer::Run() {
+#ifdef __linux__
+  // Only runs when no other thread wants the CPU
+  sched_param parameters{};
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters);
+#endif
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_condition.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+    if (m_jobs.empty()) {
+      return;
+    }
+    std::function<void()> job = std::move(m_jobs.front());
+    m_jobs.pop();
+    ++m_n_running_jobs;
+    lock.unlock();
+    job();
+    // The job and what it captured are destroyed outside of the lock as well
+    job = nullptr;
+    lock.lock();
+    --m_n_running_jobs;
+    if (m_jobs.empty() && m_n_running_jobs == 0) {
+      m_idle_condition.notify_all();
+    }
+  }
+}
+}  // namespace oaz::reclaimer
+#endif  // OAZ_RECLAIMER_RECLAIMER_HPP_
@@ -0,0 +1,266 @@
+#include "oaz/self_play/self_play.hpp"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "oaz/mcts/search.hpp"
+#include "oaz/mcts/search_completion_queue.hpp"
+
+oaz::self_play::SelfPlay::SelfPlay(
+    const std::vector<oaz::mcts::PlayerSearchProperties>&
+        player_search_properties,
+    std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool,
+    const SelfPlayOptions& options)
+    : m_player_search_properties(player_search_properties),
+      m_thread_pool(std::move(thread_pool)),
+      m_options(options),
+      m_board_size(0),
+      m_policy_size(0) {
+  std::random_device seeder;
+  m_generator.seed(seeder());
+}
+
+void oaz::self_play::SelfPlay::Play(const oaz::games::Game& game,
+                                    size_t n_games) {
+  std::vector<const oaz::games::Game*> games(n_games, &game);
+  Play(games);
+}
+
+void oaz::self_play::SelfPlay::Play(
+    const std::vector<const oaz::games::Game*>& games) {
+  if (games.empty()) {
+    return;
+  }
+  SetGameSizes(*games[0]);
+
+  // Declared first, so that it outlives the searches pushing to it
+  oaz::mcts::SearchCompletionQueue queue;
+  std::vector<GameSlot> slots(
+      std::min(std::max(m_options.n_concurrent_games, size_t(1)),
+               games.size()));
+
+  size_t n_started_games = 0;
+  // Starts the next game that is not already finished in a slot. Returns
+  // false once every game has been started.
+  auto start_next_game = [&](size_t index) {
+    while (n_started_games != games.size()) {
+      if (StartGame(&slots[index], *games[n_started_games++])) {
+        LaunchSearch(&slots[index], index, &queue);
+        return true;
+      }
+    }
+    return false;
+  };
+
+  try {
+    size_t n_active_slots = 0;
+    for (size_t index = 0; index != slots.size(); ++index) {
+      if (start_next_game(index)) {
+        ++n_active_slots;
+      }
+    }
+
+    while (n_active_slots != 0) {
+      size_t index = queue.Pop();
+      GameSlot* slot = &slots[index];
+      if (!PlayMove(slot)) {
+        LaunchSearch(slot, index, &queue);
+        continue;
+      }
+      RecordGame(slot);
+      if (!start_next_game(index)) {
+        --n_active_slots;
+      }
+    }
+  } catch (...) {
+    // The searches still running push to the queue until they are done
+    size_t n_running_searches = 0;
+    for (GameSlot& slot : slots) {
+      if (slot.search) {
+        slot.search->Stop();
+        ++n_running_searches;
+      }
+    }
+    for (; n_running_searches != 0; --n_running_searches) {
+      queue.Pop();
+    }
+    throw;
+  }
+}
+
+void oaz::self_play::SelfPlay::SetGameSizes(const oaz::games::Game& game) {
+  m_board_shape = game.ClassMethods().GetBoardShape();
+  m_board_size = std::accumulate(m_board_shape.begin(), m_board_shape.end(),
+                                 size_t(1), std::multiplies<size_t>());
+  m_policy_size = game.ClassMethods().GetMaxNumberOfMoves();
+}
+
+bool oaz::self_play::SelfPlay::StartGame(GameSlot* slot,
+                                         const oaz::games::Game& game) {
+  slot->game = game.Clone();
+  slot->search = nullptr;
+  slot->root = nullptr;
+  slot->boards.clear();
+  slot->policies.clear();
+  slot->players.clear();
+  if (slot->game->IsFinished()) {
+    // There is no move to search for
+    RecordGame(slot);
+    return false;
+  }
+  return true;
+}
+
+void oaz::self_play::SelfPlay::LaunchSearch(
+    GameSlot* slot, size_t index, oaz::mcts::SearchCompletionQueue* queue) {
+  slot->search = oaz::mcts::Search::Launch(
+      *slot->game, m_player_search_properties, m_thread_pool,
+      m_options.search_options, slot->root,
+      [queue, index] { queue->Push(index); });
+}
+
+bool oaz::self_play::SelfPlay::PlayMove(GameSlot* slot) {
+  std::shared_ptr<oaz::mcts::Search> search = std::move(slot->search);
+  std::shared_ptr<oaz::mcts::SearchNode> root = search->GetTreeRoot();
+
+  std::vector<size_t> moves;
+  std::vector<size_t> n_visits;
+  size_t total_n_visits = 0;
+  for (size_t i = 0; i != root->GetNChildren(); ++i) {
+    oaz::mcts::SearchNode* child = root->GetChild(i);
+    moves.push_back(child->GetMove());
+    n_visits.push_back(child->GetNVisits());
+    total_n_visits += n_visits.back();
+  }
+  if (total_n_visits == 0) {
+    // The root was not expanded: all moves are equally likely
+    slot->game->GetAvailableMoves(&moves);
+    n_visits.assign(moves.size(), 1);
+    total_n_visits = moves.size();
+  }
+
+  std::vector<float> policy(m_policy_size, 0.);
+  size_t move = 0;
+  if (search->HasGumbelRoot()) {
+    // The Gumbel noise of the root already explores: its move is played, and
+    // its improved policy is learnt
+    std::vector<float> improved_policy = search->GetImprovedPolicy();
+    for (size_t i = 0; i != moves.size(); ++i) {
+      policy[moves[i]] = improved_policy[i];
+    }
+    move = search->GetGumbelMove();
+  } else {
+    for (size_t i = 0; i != moves.size(); ++i) {
+      policy[moves[i]] = static_cast<float>(n_visits[i]) / total_n_visits;
+    }
+    move = SampleMove(moves, n_visits);
+  }
+  // A folded child stands for its mirror move as well, which is played half
+  // of the time so that games cover both halves of symmetric openings
+  bool mirrored = false;
+  for (const auto& [folded_move, mirror_move] : search->GetFoldedMoves()) {
+    if (folded_move == move) {
+      mirrored = std::bernoulli_distribution(0.5)(m_generator);
+      move = mirrored ? mirror_move : move;
+      break;
+    }
+  }
+  search->UnfoldPolicy(&policy);
+  search = nullptr;
+  RecordPosition(slot, policy.data());
+
+  // The tree has no subtree for a mirror move
+  slot->root =
+      m_options.reuse_tree && !mirrored
+          ? oaz::mcts::AdvanceRoot(root, move,
+                                   m_options.search_options.reclaimer)
+          : nullptr;
+  slot->game->PlayMove(move);
+  return slot->game->IsFinished();
+}
+
+size_t oaz::self_play::SelfPlay::SampleMove(
+    const std::vector<size_t>& moves, const std::vector<size_t>& n_visits) {
+  if (m_options.temperature <= 0.) {
+    return moves[std::max_element(n_visits.begin(), n_visits.end()) -
+                 n_visits.begin()];
+  }
+  std::vector<double> weights(n_visits.size());
+  for (size_t i = 0; i != n_visits.size(); ++i) {
+    weights[i] = std::pow(static_cast<double>(n_visits[i]),
+                          1. / m_options.temperature);
+  }
+  std::discrete_distribution<size_t> distribution(weights.begin(),
+                                                  weights.end());
+  return moves[distribution(m_generator)];
+}
+
+void oaz::self_play::SelfPlay::RecordPosition(GameSlot* slot,
+                                              const float* policy) {
+  size_t offset = slot->boards.size();
+  slot->boards.resize(offset + m_board_size);
+  slot->game->WriteCanonicalStateToTensorMemory(&slot->boards[offset]);
+  slot->policies.insert(slot->policies.end(), policy, policy + m_policy_size);
+  slot->players.push_back(slot->game->GetCurrentPlayer());
+}
+
+void oaz::self_play::SelfPlay::RecordGame(GameSlot* slot) {
+  // The final position is recorded with a uniform policy
+  std::vector<float> policy(m_policy_size, 1. / m_policy_size);
+  RecordPosition(slot, policy.data());
+
+  float score = slot->game->GetScore();
+  size_t n_positions = slot->players.size();
+  float discount = 1.;
+  std::vector<float> values(n_positions);
+  for (size_t i = n_positions; i-- != 0;) {
+    values[i] = (slot->players[i] == 0 ? score : -score) * discount;
+    discount *= m_options.discount_factor;
+  }
+
+  m_boards.insert(m_boards.end(), slot->boards.begin(), slot->boards.end());
+  m_policies.insert(m_policies.end(), slot->policies.begin(),
+                    slot->policies.end());
+  m_values.insert(m_values.end(), values.begin(), values.end());
+  slot->root = nullptr;
+}
+
+void oaz::self_play::SelfPlay::Clear() {
+  m_boards.clear();
+  m_policies.clear();
+  m_values.clear();
+}
+
+size_t oaz::self_play::SelfPlay::GetNPositions() const {
+  return m_values.size();
+}
+
+const std::vector<int>& oaz::self_play::SelfPlay::GetBoardShape() const {
+  return m_board_shape;
+}
+
+size_t oaz::self_play::SelfPlay::GetBoardSize() const { return m_board_size; }
+
+size_t oaz::self_play::SelfPlay::GetPolicySize() const {
+  return m_policy_size;
+}
+
+const std::vector<float>& oaz::self_play::SelfPlay::GetBoards() const {
+  return m_boards;
+}
+
+const std::vector<float>& oaz::self_play::SelfPlay::GetPolicies() const {
+  return m_policies;
+}
+
+const std::vector<float>& oaz::self_play::SelfPlay::GetValues() const {
+  return m_values;
+}
@@ -0,0 +1,110 @@
+#ifndef OAZ_SELF_PLAY_SELF_PLAY_HPP_
+#define OAZ_SELF_PLAY_SELF_PLAY_HPP_
+
+#include <stdint.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "oaz/games/game.hpp"
+#include "oaz/mcts/search.hpp"
+#include "oaz/mcts/search_completion_queue.hpp"
+#include "oaz/thread_pool/thread_pool.hpp"
+
+namespace oaz::self_play {
+
+class SelfPlayOptions {
+ public:
+  SelfPlayOptions()
+      : n_concurrent_games(1),
+        temperature(1.),
+        discount_factor(1.),
+        reuse_tree(true) {}
+
+  /* Number of games whose searches run at the same time */
+  size_t n_concurrent_games;
+  /* Options of the search run for each move */
+  oaz::mcts::SearchOptions search_options;
+  /* Moves are sampled with probabilities proportional to the visit counts of
+   * the children of the root raised to 1 / temperature. With a temperature
+   * of 0, the most visited move is played. Searches with a Gumbel root pick
+   * the move themselves. */
+  float temperature;
+  /* Values are discounted by this factor for each move separating a position
+   * from the end of the game */
+  float discount_factor;
+  /* Whether the search of a move starts from the subtree of the previous
+   * search */
+  bool reuse_tree;
+};
+
+/* Plays games of self-play, running the searches of many games at once from
+ * a single thread. For each position encountered, the canonical board, the
+ * visit count distribution of the search, or its improved policy with a
+ * Gumbel root, and the final score of the game from the point of view of the
+ * player to move are appended to contiguous buffers, which are kept across
+ * calls to Play until Clear is called. Policies folded by fold_symmetries are
+ * unfolded before being recorded. */
+class SelfPlay {
+ public:
+  SelfPlay(const std::vector<oaz::mcts::PlayerSearchProperties>&,
+           std::shared_ptr<oaz::thread_pool::ThreadPool>,
+           const SelfPlayOptions&);
+
+  /* Plays a game from each of the given positions */
+  void Play(const std::vector<const oaz::games::Game*>&);
+  /* Plays n games from the given position */
+  void Play(const oaz::games::Game&, size_t);
+
+  void Clear();
+
+  size_t GetNPositions() const;
+  const std::vector<int>& GetBoardShape() const;
+  size_t GetBoardSize() const;
+  size_t GetPolicySize() const;
+  /* The board and policy of position i start at i * GetBoardSize() and
+   * i * GetPolicySize() respectively */
+  const std::vector<float>& GetBoards() const;
+  const std::vector<float>& GetPolicies() const;
+  const std::vector<float>& GetValues() const;
+
+ private:
+  class GameSlot {
+   public:
+    std::unique_ptr<oaz::games::Game> game;
+    std::shared_ptr<oaz::mcts::Search> search;
+    std::shared_ptr<oaz::mcts::SearchNode> root;
+    std::vector<float> boards;
+    std::vector<float> policies;
+    std::vector<size_t> players;
+  };
+
+  void SetGameSizes(const oaz::games::Game&);
+  /* Returns false if the game is already finished, in which case it is
+   * recorded at once */
+  bool StartGame(GameSlot*, const oaz::games::Game&);
+  void LaunchSearch(GameSlot*, size_t, oaz::mcts::SearchCompletionQueue*);
+  /* Records the position of the slot and plays the move chosen by its search.
+   * Returns true if the game is finished. */
+  bool PlayMove(GameSlot*);
+  size_t SampleMove(const std::vector<size_t>&, const std::vector<size_t>&);
+  void RecordPosition(GameSlot*, const float*);
+  void RecordGame(GameSlot*);
+
+  std::vector<oaz::mcts::PlayerSearchProperties> m_player_search_properties;
+  std::shared_ptr<oaz::thread_pool::ThreadPool> m_thread_pool;
+  SelfPlayOptions m_options;
+
+  std::vector<int> m_board_shape;
+  size_t m_board_size;
+  size_t m_policy_size;
+
+  std::vector<float> m_boards;
+  std::vector<float> m_policies;
+  std::vector<float> m_values;
+
+  std::mt19937 m_generator;
+};
+}  // namespace oaz::self_play
+#endif  // OAZ_SELF_PLAY_SELF_PLAY_HPP_
@@ -18,14 +18,16 @@ void oaz::simulation::SimulationEvaluator::RequestEvaluation(
     oaz::games::Game* game,
     std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
     oaz::thread_pool::Task* task) {
-  std::vector<size_t> available_moves;
-  std::unique_ptr<oaz::games::Game> game_copy = game->Clone();
-  *evaluation = std::move(std::make_unique<SimulationEvaluation>(Simulate(game_copy.get())));
+  *evaluation = std::move(std::make_unique<SimulationEvaluation>(Simulate(game)));
   m_thread_pool->enqueue(task);
 }
 
+/* Plays the game out in place, then undoes the playout so that the game is
+ * handed back as it was received */
 float oaz::simulation::SimulationEvaluator::Simulate(oaz::games::Game* game) {
-  std::vector<size_t> available_moves;
+  static thread_local std::vector<size_t> available_moves;
+  static thread_local std::vector<size_t> played_moves;
+  played_moves.clear();
   size_t current_player = game->GetCurrentPlayer();
   while (!game->IsFinished()) {
     game->GetAvailableMoves(&available_moves);
@@ -33,8 +35,13 @@ float oaz::simulation::SimulationEvaluator::Simulate(oaz::games::Game* game) {
     size_t random_move_index = dis(m_generator);
     auto random_move = available_moves[random_move_index];
     game->PlayMove(random_move);
+    played_moves.push_back(random_move);
   }
   float score = game->GetScore();
+  for (auto move = played_moves.rbegin(); move != played_moves.rend();
+       ++move) {
+    game->UndoMove(*move);
+  }
 
   return (current_player == 0) ? score : score * -1.0F;
 }
@@ -3,6 +3,8 @@
 
 // See COPYING for original license
 
+#include <stdint.h>
+
 #include <condition_variable>
 #include <functional>
 #include <future>
@@ -20,6 +22,11 @@ class ThreadPool {
  public:
   explicit ThreadPool(size_t n_threads);
   void enqueue(oaz::thread_pool::Task* task);
+  size_t GetNThreads() const { return workers.size(); }
+  /* Index of the calling thread among the workers of its pool, or
+   * NOT_A_WORKER if it does not belong to a pool */
+  static constexpr size_t NOT_A_WORKER = SIZE_MAX;
+  static size_t GetWorkerIndex() { return WorkerIndex(); }
   ~ThreadPool();
   ThreadPool(const ThreadPool&) = delete;
   ThreadPool(ThreadPool&&) = delete;
@@ -27,6 +34,11 @@ class ThreadPool {
   ThreadPool& operator=(ThreadPool&&) = delete;
 
  private:
+  static size_t& WorkerIndex() {
+    static thread_local size_t worker_index = NOT_A_WORKER;
+    return worker_index;
+  }
+
   std::vector<std::thread> workers;
   std::queue<oaz::thread_pool::Task*> tasks;
   std::mutex queue_mutex;
@@ -36,7 +48,8 @@ class ThreadPool {
 
 inline ThreadPool::ThreadPool(size_t n_threads) : stop(false) {
   for (size_t i = 0; i < n_threads; ++i) {
-    workers.emplace_back([this] {
+    workers.emplace_back([this, i] {
+      WorkerIndex() = i;
       for (;;) {
         oaz::thread_pool::Task* task = nullptr;
 
@@ -1,9 +1,16 @@
+import time
+
 from .bot import Bot
 
 import tensorflow.compat.v1.keras.backend as K
 
 from pyoaz.evaluator.nn_evaluator import Model, NNEvaluator
-from pyoaz.search import Search, PlayerSearchProperties, select_best_move_by_visit_count
+from pyoaz.search import (
+    Search,
+    PlayerSearchProperties,
+    TimeAllocator,
+    select_best_move_by_visit_count,
+)
 from pyoaz.selection import AZSelector
 from pyoaz.thread_pool import ThreadPool
 from pyoaz.utils import get_keras_model_node_names
@@ -51,8 +58,27 @@ class AZBot(Bot):
     def model(self):
         return self._model
 
-    def __init__(self, game_class, model, n_simulations_per_move=100):
+    @property
+    def time_allocator(self):
+        return self._time_allocator
+
+    def __init__(
+        self,
+        game_class,
+        model,
+        n_simulations_per_move=100,
+        time_per_game=None,
+        expected_n_moves=20,
+    ):
+        """If time_per_game is given, in seconds, each move is searched for
+        a share of that clock, or for n_simulations_per_move, whichever comes
+        first. Call reset_clock at the start of each game."""
         self._model = model
+        self._time_allocator = (
+            TimeAllocator(time_per_game, expected_n_moves)
+            if time_per_game is not None
+            else None
+        )
         self._n_simulations_per_move = n_simulations_per_move
         self._game_class = game_class
         self._thread_pool = ThreadPool()
@@ -65,7 +91,15 @@ class AZBot(Bot):
 
         self._selector = AZSelector()
 
+    def reset_clock(self):
+        if self.time_allocator is not None:
+            self.time_allocator.reset()
+
     def play(self, game):
+        time_budget = 0.0
+        if self.time_allocator is not None:
+            time_budget = self.time_allocator.get_move_budget()
+        start = time.monotonic()
         search = Search(
             game=game,
             player_search_properties=[
@@ -74,5 +108,9 @@ class AZBot(Bot):
             ],
             thread_pool=self.thread_pool,
             n_iterations=self.n_simulations_per_move,
+            time_budget=time_budget,
+            stop_when_decided=True,
         )
+        if self.time_allocator is not None:
+            self.time_allocator.consume_time(time.monotonic() - start)
         return select_best_move_by_visit_count(search)
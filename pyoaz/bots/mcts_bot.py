@@ -1,5 +1,12 @@
+import time
+
 from pyoaz.thread_pool import ThreadPool
-from pyoaz.search import Search, PlayerSearchProperties, select_best_move_by_visit_count
+from pyoaz.search import (
+    Search,
+    PlayerSearchProperties,
+    TimeAllocator,
+    select_best_move_by_visit_count,
+)
 from pyoaz.selection import UCTSelector
 from pyoaz.evaluator.simulation_evaluator import SimulationEvaluator
 from .bot import Bot
@@ -7,9 +14,22 @@ from .bot import Bot
 
 class MCTSBot(Bot):
     def __init__(
-        self, n_iterations=100, n_concurrent_workers=1, thread_pool=None
+        self,
+        n_iterations=100,
+        n_concurrent_workers=1,
+        thread_pool=None,
+        time_per_game=None,
+        expected_n_moves=20,
     ):
+        """If time_per_game is given, in seconds, each move is searched for
+        a share of that clock, or for n_iterations, whichever comes first.
+        Call reset_clock at the start of each game."""
         self._n_iterations = n_iterations
+        self._time_allocator = (
+            TimeAllocator(time_per_game, expected_n_moves)
+            if time_per_game is not None
+            else None
+        )
         self._n_concurrent_workers = n_concurrent_workers
         if thread_pool is not None:
             self._thread_pool = thread_pool
@@ -38,7 +58,19 @@ class MCTSBot(Bot):
     def selector(self):
         return self._selector
 
+    @property
+    def time_allocator(self):
+        return self._time_allocator
+
+    def reset_clock(self):
+        if self.time_allocator is not None:
+            self.time_allocator.reset()
+
     def play(self, game):
+        time_budget = 0.0
+        if self.time_allocator is not None:
+            time_budget = self.time_allocator.get_move_budget()
+        start = time.monotonic()
         search = Search(
             game=game,
             player_search_properties=[
@@ -50,5 +82,9 @@ class MCTSBot(Bot):
             n_iterations=self.n_iterations,
             noise_epsilon=0.0,
             noise_alpha=0.0,
+            time_budget=time_budget,
+            stop_when_decided=True,
         )
+        if self.time_allocator is not None:
+            self.time_allocator.consume_time(time.monotonic() - start)
         return select_best_move_by_visit_count(search)
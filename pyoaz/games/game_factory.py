@@ -28,6 +28,11 @@ class Game:
             )
         self._core.play_move(move)
 
+    def undo_move(self, move):
+        """Reverts play_move(move), where move is the last move played, in
+        place rather than by copying the game"""
+        self._core.undo_move(move)
+
     @property
     def current_player(self):
         return self._core.current_player
@@ -44,6 +49,14 @@ class Game:
     def available_moves(self):
         return self._core.available_moves
 
+    @property
+    def mirror_symmetric(self):
+        """Whether the position is its own mirror image"""
+        return self._core.mirror_symmetric
+
+    def get_mirror_move(self, move):
+        return self._core.get_mirror_move(move)
+
     @property
     def board(self):
         return self._core.board
@@ -1,5 +1,37 @@
+from .search import MultiSearch as MultiSearchCore
+from .search import NodeBudget as NodeBudgetCore
 from .search import PlayerSearchProperties as PlayerSearchPropertiesCore
+from .search import ProvenValue
+from .search import Reclaimer as ReclaimerCore
 from .search import Search as SearchCore
+from .search import AsyncSearch as AsyncSearchCore
+from .search import SearchCompletionQueue as SearchCompletionQueueCore
+from .search import SearchOptions as SearchOptionsCore
+from .search import StopToken as StopTokenCore
+from .search import TimeAllocator as TimeAllocatorCore
+from .search import advance_root as advance_root_core
+from .search import create_root as create_root_core
+
+
+class NodeBudget:
+    """Caps the number of nodes held by all the searches it is passed to
+    together. A search expanding nodes while the budget is exceeded prunes
+    its tree."""
+
+    def __init__(self, max_n_nodes):
+        self._core = NodeBudgetCore(max_n_nodes)
+
+    @property
+    def core(self):
+        return self._core
+
+    @property
+    def n_nodes(self):
+        return self.core.n_nodes
+
+    @property
+    def max_n_nodes(self):
+        return self.core.max_n_nodes
 
 
 class PlayerSearchProperties:
@@ -18,6 +50,128 @@ class PlayerSearchProperties:
         return self._core
 
 
+class StopToken:
+    """Stops the searches it is passed to from another thread. Selections in
+    flight are completed, so that the tree remains consistent."""
+
+    def __init__(self):
+        self._core = StopTokenCore()
+
+    @property
+    def core(self):
+        return self._core
+
+    @property
+    def stopped(self):
+        return self.core.stopped
+
+    def stop(self):
+        self.core.stop()
+
+    def reset(self):
+        self.core.reset()
+
+
+class Reclaimer:
+    """Frees search trees on a background thread of low priority, so that
+    the thread releasing them, which may hold the GIL, does not wait for
+    them to be freed."""
+
+    def __init__(self):
+        self._core = ReclaimerCore()
+
+    @property
+    def core(self):
+        return self._core
+
+    @property
+    def n_pending_jobs(self):
+        return self.core.n_pending_jobs
+
+    def wait(self):
+        """Blocks until the trees released so far are freed."""
+        self.core.wait()
+
+
+class TimeAllocator:
+    """Splits the time available to a player for a whole game, in seconds,
+    between its moves."""
+
+    def __init__(self, time_per_game, expected_n_moves, increment=0.0):
+        self._core = TimeAllocatorCore(
+            time_per_game, expected_n_moves, increment
+        )
+
+    @property
+    def core(self):
+        return self._core
+
+    @property
+    def remaining_time(self):
+        return self.core.remaining_time
+
+    @property
+    def n_moves_played(self):
+        return self.core.n_moves_played
+
+    def reset(self):
+        """Starts the clock of a new game."""
+        self.core.reset()
+
+    def get_move_budget(self):
+        """Time to spend on the next move."""
+        return self.core.get_move_budget()
+
+    def consume_time(self, elapsed):
+        """Records that a move was played in elapsed seconds."""
+        self.core.consume_time(elapsed)
+
+
+def _create_search_options(
+    n_iterations,
+    n_concurrent_workers=1,
+    noise_epsilon=0.0,
+    noise_alpha=1.0,
+    virtual_loss=0.0,
+    n_sharded_levels=0,
+    time_budget=0.0,
+    stop_token=None,
+    use_transpositions=False,
+    use_solver=False,
+    stop_when_decided=False,
+    widening_constant=0.0,
+    widening_exponent=0.5,
+    n_leaves_per_task=1,
+    reclaimer=None,
+    max_n_nodes=0,
+    node_budget=None,
+    fold_symmetries=False,
+):
+    options = SearchOptionsCore()
+    options.batch_size = n_concurrent_workers
+    options.n_iterations = n_iterations
+    options.noise_epsilon = noise_epsilon
+    options.noise_alpha = noise_alpha
+    options.virtual_loss = virtual_loss
+    options.n_sharded_levels = n_sharded_levels
+    options.time_budget = time_budget
+    options.use_transpositions = use_transpositions
+    options.use_solver = use_solver
+    options.stop_when_decided = stop_when_decided
+    options.widening_constant = widening_constant
+    options.widening_exponent = widening_exponent
+    options.n_leaves_per_task = n_leaves_per_task
+    options.max_n_nodes = max_n_nodes
+    options.fold_symmetries = fold_symmetries
+    if stop_token is not None:
+        options.stop_token = stop_token.core
+    if reclaimer is not None:
+        options.reclaimer = reclaimer.core
+    if node_budget is not None:
+        options.node_budget = node_budget.core
+    return options
+
+
 class Search:
     def __init__(
         self,
@@ -28,16 +182,84 @@ class Search:
         n_concurrent_workers=1,
         noise_epsilon=0.0,
         noise_alpha=1.0,
+        root=None,
+        virtual_loss=0.0,
+        n_sharded_levels=0,
+        time_budget=0.0,
+        stop_token=None,
+        use_transpositions=False,
+        use_solver=False,
+        stop_when_decided=False,
+        widening_constant=0.0,
+        widening_exponent=0.5,
+        n_leaves_per_task=1,
+        reclaimer=None,
+        max_n_nodes=0,
+        node_budget=None,
+        fold_symmetries=False,
     ):
+        """With a positive virtual_loss, concurrent workers are steered
+        towards different leaves instead of waiting on the same leaf to be
+        evaluated. The statistics of the nodes in the first n_sharded_levels
+        levels of the tree are kept per thread, which avoids contention on
+        the root with many threads. The search stops after n_iterations or
+        after time_budget seconds if positive, whichever comes first, or when
+        stop_token is stopped. With use_transpositions, a position reached
+        through different paths is expanded and evaluated once: the nodes
+        found along the other paths are aliases of the first one. With
+        use_solver, wins, draws and losses found at the end of games are
+        propagated up the tree as the proven values of the nodes, and the
+        search stops once the root is proven. With stop_when_decided, the
+        search stops once the most visited root move can no longer be
+        overtaken; n_saved_iterations then tells how many iterations were
+        left out. With a positive widening_constant, selections from a node
+        visited n times only consider its
+        ceil(widening_constant * n ** widening_exponent) children with the
+        highest priors. With n_leaves_per_task above 1, each selection task
+        descends to up to n_leaves_per_task leaves before requesting their
+        evaluations together. With a reclaimer, the tree is freed on its
+        thread once the search is destroyed and no other reference to the
+        root is left. With a positive max_n_nodes, or with a node_budget
+        shared between searches, the search waits for its selections in
+        flight whenever the limit is exceeded and frees the subtrees of the
+        least visited nodes; n_prunings counts how often this happened.
+        With fold_symmetries, a root position that is its own mirror image
+        gets a single child per pair of mirror moves; policies over the
+        root moves are then to be passed through unfold_policy."""
 
-        self._core = SearchCore(
+        options = _create_search_options(
+            n_iterations,
+            n_concurrent_workers=n_concurrent_workers,
+            noise_epsilon=noise_epsilon,
+            noise_alpha=noise_alpha,
+            virtual_loss=virtual_loss,
+            n_sharded_levels=n_sharded_levels,
+            time_budget=time_budget,
+            stop_token=stop_token,
+            use_transpositions=use_transpositions,
+            use_solver=use_solver,
+            stop_when_decided=stop_when_decided,
+            widening_constant=widening_constant,
+            widening_exponent=widening_exponent,
+            n_leaves_per_task=n_leaves_per_task,
+            reclaimer=reclaimer,
+            max_n_nodes=max_n_nodes,
+            node_budget=node_budget,
+            fold_symmetries=fold_symmetries,
+        )
+        self._core = self._create_core(
             game.core,
             [p.core for p in player_search_properties],
             thread_pool.core,
-            n_concurrent_workers,
-            n_iterations,
-            noise_epsilon,
-            noise_alpha,
+            options,
+            root,
+        )
+
+    def _create_core(
+        self, game, player_search_properties, thread_pool, options, root
+    ):
+        return SearchCore(
+            game, player_search_properties, thread_pool, options, root
         )
 
     @property
@@ -48,14 +270,185 @@ class Search:
     def tree_root(self):
         return self.core.get_tree_root()
 
+    @property
+    def n_saved_iterations(self):
+        return self.core.n_saved_iterations
+
+    @property
+    def n_prunings(self):
+        return self.core.n_prunings
+
+    @property
+    def has_gumbel_root(self):
+        return self.core.has_gumbel_root
+
+    @property
+    def gumbel_move(self):
+        """The move to play, chosen by the Gumbel root of the search"""
+        return self.core.gumbel_move
+
+    def get_improved_policy(self):
+        """Improved policy over the children of the root, in their order, to
+        train on with a Gumbel root"""
+        return self.core.get_improved_policy()
+
+    def get_folded_moves(self):
+        """Pairs of a root move and of its mirror move folded into it"""
+        return self.core.get_folded_moves()
+
+    def unfold_policy(self, policy):
+        """Splits, in place, the probability of each folded root move evenly
+        with its mirror move, in a policy indexed by move"""
+        policy[:] = self.core.unfold_policy(policy)
+        return policy
+
+    def reset(self, game, n_iterations, root=None):
+        """Searches game with the same options and players, reusing the
+        buffers of this search. Without a root, the nodes of the previous
+        tree are recycled unless other references to it are held. Blocks
+        until the new search is done."""
+        self.core.reset(game.core, n_iterations, root)
+
+    def advance_root(self, move, reclaimer=None):
+        """Detaches the subtree under the given root move, to be passed as
+        root to the Search of the next position. The rest of the tree is
+        freed, on the thread of reclaimer if one is given."""
+        if reclaimer is None:
+            return advance_root_core(self.tree_root, move)
+        return advance_root_core(self.tree_root, move, reclaimer.core)
+
+
+class SearchCompletionQueue:
+    """Collects the keys of AsyncSearch objects as they complete, so that one
+    thread can wait on many searches at once."""
+
+    def __init__(self):
+        self._core = SearchCompletionQueueCore()
+
+    @property
+    def core(self):
+        return self._core
+
+    def __len__(self):
+        return self.core.size
+
+    def get(self, timeout=None):
+        """Returns the key of the next search to complete, or None if none
+        completes within timeout seconds."""
+        return self.core.pop(-1.0 if timeout is None else timeout)
+
+
+class AsyncSearch(Search):
+    """Search that runs in the background, so that a single thread can drive
+    many searches sharing the same evaluator. Takes the same arguments as
+    Search; if completion_queue is given, key is put into it once the search
+    is done. The tree must not be read before the search is done."""
+
+    def __init__(self, *args, completion_queue=None, key=0, **kwargs):
+        self._completion_queue = completion_queue
+        self._key = key
+        super().__init__(*args, **kwargs)
+
+    def _create_core(
+        self, game, player_search_properties, thread_pool, options, root
+    ):
+        return AsyncSearchCore(
+            game,
+            player_search_properties,
+            thread_pool,
+            options,
+            root,
+            None
+            if self._completion_queue is None
+            else self._completion_queue.core,
+            self._key,
+        )
+
+    @property
+    def key(self):
+        return self._key
+
+    @property
+    def done(self):
+        return self.core.done
+
+    def wait(self):
+        self.core.wait()
+
+    def stop(self):
+        """Starts no new simulation; the search is done once those in flight
+        are completed."""
+        self.core.stop()
+
+    def reset(self, game, n_iterations, root=None):
+        """Like Search.reset, but returns at once; key is put into the
+        completion queue again once the new search is done. The previous
+        search must be done."""
+        self.core.relaunch(game.core, n_iterations, root)
+
+
+class MultiSearch:
+    """Searches many independent positions at once over one thread pool, so
+    that the batches of the evaluator fill from many trees. At most
+    n_concurrent_searches searches run at a time, if positive. roots, if
+    given, holds a root or None per game. The other keyword arguments are
+    those of Search. Blocks until all the searches are done."""
+
+    def __init__(
+        self,
+        games,
+        player_search_properties,
+        thread_pool,
+        n_iterations,
+        n_concurrent_searches=0,
+        roots=None,
+        **kwargs,
+    ):
+        options = _create_search_options(n_iterations, **kwargs)
+        self._core = MultiSearchCore(
+            [game.core for game in games],
+            [p.core for p in player_search_properties],
+            thread_pool.core,
+            options,
+            n_concurrent_searches,
+            roots,
+        )
+
+    @property
+    def core(self):
+        return self._core
+
+    def __len__(self):
+        return self.core.n_searches
+
+    def get_tree_root(self, index):
+        return self.core.get_tree_root(index)
+
+    def get_visits(self, index, n_moves):
+        """Visit counts of the moves of the root of search index"""
+        return self.core.get_visits(index, n_moves)
+
+
+def create_root(use_huge_pages=False):
+    """Creates an empty tree root, whose nodes are allocated from an arena
+    optionally backed by huge pages. It can be passed as root to Search."""
+    return create_root_core(use_huge_pages)
+
 
 def select_best_move_by_visit_count(search):
+    """Most visited move, except that a move proven to win is always played
+    and moves proven to lose are only played if all moves lose."""
     root = search.tree_root
     best_move = -1
-    best_n_visits = -1
+    best_key = None
     for i in range(root.n_children):
         child = root.get_child(i)
-        if child.n_visits > best_n_visits:
-            best_n_visits = child.n_visits
+        key = (
+            child.proven == ProvenValue.WIN,
+            child.proven != ProvenValue.LOSS,
+            child.n_visits,
+        )
+        if best_key is None or key > best_key:
+            best_key = key
             best_move = child.move
     return best_move
@@ -1,12 +1,13 @@
 from .selection import (
     UCTSelector as UCTSelectorCore,
     AZSelector as AZSelectorCore,
+    GumbelSelector as GumbelSelectorCore,
 )
 
 
 class UCTSelector:
-    def __init__(self):
-        self._core = UCTSelectorCore()
+    def __init__(self, vectorised: bool = False):
+        self._core = UCTSelectorCore(vectorised)
 
     @property
     def core(self):
@@ -14,8 +15,27 @@ class UCTSelector:
 
 
 class AZSelector:
-    def __init__(self):
-        self._core = AZSelectorCore()
+    def __init__(self, vectorised: bool = False):
+        self._core = AZSelectorCore(vectorised)
+
+    @property
+    def core(self):
+        return self._core
+
+
+class GumbelSelector:
+    """Selection of Gumbel AlphaZero. For the player to move at the root, the
+    search samples n_sampled_children children of the root and spreads the
+    simulations between them by sequential halving, which improves on the
+    prior with few simulations."""
+
+    def __init__(
+        self,
+        n_sampled_children: int = 16,
+        c_visit: float = 50.0,
+        c_scale: float = 1.0,
+    ):
+        self._core = GumbelSelectorCore(n_sampled_children, c_visit, c_scale)
 
     @property
     def core(self):
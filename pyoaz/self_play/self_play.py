@@ -11,10 +11,13 @@ from tqdm import tqdm
 
 from pyoaz.cache.simple_cache import SimpleCache
 from pyoaz.evaluator.nn_evaluator import Model, NNEvaluator
-from pyoaz.search import Search, PlayerSearchProperties
+from pyoaz.search import Search, PlayerSearchProperties, Reclaimer
 from pyoaz.selection import AZSelector
 from pyoaz.thread_pool import ThreadPool
 
+from .self_play_engine import SelfPlay as SelfPlayEngineCore
+from .self_play_engine import SelfPlayOptions as SelfPlayOptionsCore
+
 
 def stack_datasets(datasets):
     all_boards = []
@@ -46,9 +49,22 @@ class SelfPlay:
         epsilon: float = 0.25,
         alpha: float = 1.0,
         cache_size: int = None,
+        reuse_tree: bool = True,
+        native: bool = False,
+        selector=None,
+        fold_symmetries=False,
         logger=None,
         verbosity=1,
     ):
+        """With native set, games are played by the C++ self-play engine,
+        which runs the searches of n_threads games at once from a single
+        thread without holding the GIL. The selector defaults to an
+        AZSelector; with a GumbelSelector, a few dozen simulations per move
+        are enough, and the moves and policies of the Gumbel root are used
+        instead of the visit counts. With fold_symmetries, the searches of
+        positions that are their own mirror image spend their simulations on
+        a single move of each pair of mirror moves; the recorded policies
+        give both moves of a pair the same probability."""
         self.game = game
         self.policy_size = len(game().available_moves)
         self.dimensions = self.game().board.shape
@@ -60,11 +76,16 @@ class SelfPlay:
         self.epsilon = epsilon
         self.verbosity = verbosity
         self.alpha = alpha
+        self.reuse_tree = reuse_tree
+        self.native = native
         self.logger = logger
         if logger is None:
             self.logger = setup_logger()
-        self.selector = AZSelector()
+        self.selector = AZSelector() if selector is None else selector
+        self.fold_symmetries = fold_symmetries
         self.thread_pool = ThreadPool(n_workers)
+        # Frees the trees of past moves without holding the GIL
+        self.reclaimer = Reclaimer()
 
         # hard coding ~ 50 moves per game on average
         cache_size = self.n_games_per_worker * self.n_threads * 50
@@ -198,6 +219,11 @@ class SelfPlay:
 
         game_queue = self.create_work(n_games, starting_positions, n_repeats)
 
+        if self.native:
+            final_dataset = self._native_self_play(game_queue)
+            self._log_stats(verbose=debug)
+            return final_dataset
+
         # Accumulator for each thread
         dataset_queue = Queue()
 
@@ -299,10 +325,38 @@ class SelfPlay:
             }
         )
 
+    def _native_self_play(self, game_queue: Queue) -> Dict:
+        """Plays all games in game_queue with the C++ self-play engine."""
+
+        options = SelfPlayOptionsCore()
+        options.n_concurrent_games = self.n_threads
+        options.search_options.batch_size = self.n_tree_workers
+        options.search_options.n_iterations = self.n_simulations_per_move
+        options.search_options.noise_epsilon = self.epsilon
+        options.search_options.noise_alpha = self.alpha
+        options.search_options.fold_symmetries = self.fold_symmetries
+        options.discount_factor = self.discount_factor
+        options.reuse_tree = self.reuse_tree
+
+        engine = SelfPlayEngineCore(
+            [
+                PlayerSearchProperties(self.evaluator, self.selector).core,
+                PlayerSearchProperties(self.evaluator, self.selector).core,
+            ],  # For now assumes there are 2 players
+            self.thread_pool.core,
+            options,
+        )
+        games = []
+        while not game_queue.empty():
+            games.append(game_queue.get().core)
+        engine.play(games)
+        return engine.get_dataset()
+
     def _play_one_game(self, game, flag=False) -> Tuple[List, List, List]:
 
         boards = []
         policies = []
+        root = None
 
         while not game.finished:
 
@@ -320,27 +374,55 @@ class SelfPlay:
                 n_iterations=self.n_simulations_per_move,
                 noise_epsilon=self.epsilon,
                 noise_alpha=self.alpha,
+                root=root,
+                reclaimer=self.reclaimer,
+                fold_symmetries=self.fold_symmetries,
             )
-            root = search.tree_root
+            tree_root = search.tree_root
 
             policy = np.zeros(shape=self.policy_size, dtype=np.float32)
-            for i in range(root.n_children):
-
-                child = root.get_child(i)
-                move = child.move
-                n_visits = child.n_visits
-                policy[move] = n_visits
-
-            # There's an off-by-one error in the Search's n_sim_per_move
-            policy = policy / (self.n_simulations_per_move - 1)
-            policies.append(policy)
+            if search.has_gumbel_root:
+                # The Gumbel root picks the move and improves the policy
+                improved_policy = search.get_improved_policy()
+                for i in range(tree_root.n_children):
+                    policy[tree_root.get_child(i).move] = improved_policy[i]
+            else:
+                for i in range(tree_root.n_children):
+
+                    child = tree_root.get_child(i)
+                    move = child.move
+                    n_visits = child.n_visits
+                    policy[move] = n_visits
+
+            # The root visit is not attributed to any child
+            policy = policy / policy.sum()
+            policies.append(search.unfold_policy(policy.copy()))
             if self.verbosity > 1:
                 self.logger.debug(f"policy: \n{policy}")
 
-            move = int(np.random.choice(np.arange(self.policy_size), p=policy))
+            if search.has_gumbel_root:
+                move = search.gumbel_move
+            else:
+                move = int(
+                    np.random.choice(np.arange(self.policy_size), p=policy)
+                )
+            # A folded child stands for its mirror move as well, which is
+            # played half of the time; the tree has no subtree for it
+            mirrored = False
+            for folded_move, mirror_move in search.get_folded_moves():
+                if folded_move == move:
+                    mirrored = np.random.random() < 0.5
+                    move = mirror_move if mirrored else move
+                    break
 
             boards.append(game.canonical_board)
 
+            if self.reuse_tree:
+                root = (
+                    None
+                    if mirrored
+                    else search.advance_root(move, self.reclaimer)
+                )
             game.play_move(move)
 
         boards.append(game.canonical_board)
@@ -80,3 +80,18 @@ def test_tic_tac_toe_canonical():
     board2 = game2.canonical_board
     np.testing.assert_array_equal(board, board2)
     assert type(game2) == type(game)
+
+
+def test_undo_move():
+    for game_class, moves in [
+        (ConnectFour, [3, 3, 4]),
+        (TicTacToe, [4, 0, 8]),
+    ]:
+        game = game_class()
+        boards = []
+        for move in moves:
+            boards.append(game.board)
+            game.play_move(move)
+        for move, board in zip(reversed(moves), reversed(boards)):
+            game.undo_move(move)
+            np.testing.assert_array_equal(game.board, board)
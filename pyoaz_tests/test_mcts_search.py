@@ -22,3 +22,48 @@ def test_mcts_search():
         noise_epsilon=0.0,
         noise_alpha=0.0,
     )
+
+
+def test_mcts_search_invalid_options():
+    import pytest
+
+    from pyoaz.thread_pool import ThreadPool
+    from pyoaz.search import Search, PlayerSearchProperties
+    from pyoaz.selection import UCTSelector
+    from pyoaz.evaluator.simulation_evaluator import SimulationEvaluator
+    from pyoaz.games.connect_four import ConnectFour
+
+    thread_pool = ThreadPool(n_workers=1)
+    evaluator = SimulationEvaluator(thread_pool=thread_pool)
+    selector = UCTSelector()
+    player_search_properties = [
+        PlayerSearchProperties(evaluator, selector),
+        PlayerSearchProperties(evaluator, selector)
+    ]
+    game = ConnectFour()
+    # Errors of the constructor are raised with the GIL held again
+    with pytest.raises((ValueError, RuntimeError)):
+        Search(
+            game=game,
+            player_search_properties=player_search_properties,
+            thread_pool=thread_pool,
+            n_concurrent_workers=2 ** 16,
+            n_iterations=100,
+        )
+    with pytest.raises((ValueError, RuntimeError)):
+        Search(
+            game=game,
+            player_search_properties=player_search_properties,
+            thread_pool=thread_pool,
+            n_iterations=100,
+            use_transpositions=True,
+            max_n_nodes=1000,
+        )
+    # The interpreter is still usable
+    search = Search(
+        game=game,
+        player_search_properties=player_search_properties,
+        thread_pool=thread_pool,
+        n_iterations=100,
+    )
+    assert search.tree_root.n_visits == 100
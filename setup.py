@@ -29,6 +29,12 @@ TARGETS = [
         "extension_file_name": "search.so",
         "module_directory": "search",
     },
+    {
+        "name": "self_play_engine",
+        "target": "self_play_engine",
+        "extension_file_name": "self_play_engine.so",
+        "module_directory": "self_play",
+    },
     {
         "name": "selection",
         "target": "selection",
@@ -0,0 +1,128 @@
+#include "oaz/arena/arena.hpp"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace oaz::arena;
+using namespace testing;
+using namespace std;
+
+TEST(InstantiationTest, Default) { Arena arena; }
+
+TEST(Allocate, Default) {
+  Arena arena;
+  void* pointer = arena.Allocate(40);
+  ASSERT_NE(pointer, nullptr);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(pointer) % Arena::ALIGNMENT, 0);
+  ASSERT_EQ(arena.GetNAllocatedBytes(), 48);
+  ASSERT_EQ(arena.GetNReservedBytes(), Arena::SLAB_SIZE);
+}
+
+TEST(GetArena, Default) {
+  Arena arena;
+  for (size_t i = 0; i != 10000; ++i) {
+    ASSERT_EQ(Arena::GetArena(arena.Allocate(40)), &arena);
+  }
+}
+
+TEST(Free, Recycle) {
+  Arena arena;
+  void* pointer = arena.Allocate(100);
+  arena.Free(pointer, 100);
+  ASSERT_EQ(arena.GetNAllocatedBytes(), 0);
+  ASSERT_EQ(arena.Allocate(100), pointer);
+}
+
+TEST(Free, RecycleAcrossThreads) {
+  Arena arena;
+  size_t n_allocations = 10000;
+  std::vector<void*> pointers;
+  for (size_t i = 0; i != n_allocations; ++i) {
+    pointers.push_back(arena.Allocate(64));
+  }
+  size_t n_reserved_bytes = arena.GetNReservedBytes();
+  std::thread freeing([&arena, &pointers]() {
+    for (void* pointer : pointers) {
+      arena.Free(pointer, 64);
+    }
+  });
+  freeing.join();
+  ASSERT_EQ(arena.GetNAllocatedBytes(), 0);
+
+  std::set<void*> freed(pointers.begin(), pointers.end());
+  for (size_t i = 0; i != n_allocations; ++i) {
+    ASSERT_EQ(freed.count(arena.Allocate(64)), 1);
+  }
+  ASSERT_EQ(arena.GetNReservedBytes(), n_reserved_bytes);
+}
+
+TEST(Free, RecycleLarge) {
+  Arena arena;
+  size_t size = Arena::GetMaxAllocationSize();
+  for (size_t i = 0; i != 100; ++i) {
+    void* pointer = arena.Allocate(size);
+    arena.Free(pointer, size);
+  }
+  ASSERT_EQ(arena.GetNAllocatedBytes(), 0);
+  ASSERT_EQ(arena.GetNReservedBytes(), Arena::SLAB_SIZE);
+
+  void* pointer = arena.Allocate(5000);
+  arena.Free(pointer, 5000);
+  ASSERT_EQ(arena.Allocate(6000), pointer);
+}
+
+TEST(Allocate, TooLarge) {
+  Arena arena;
+  ASSERT_THROW(arena.Allocate(Arena::SLAB_SIZE), std::length_error);
+}
+
+TEST(Reset, Default) {
+  Arena arena;
+  void* pointer = arena.Allocate(40);
+  ASSERT_NE(pointer, nullptr);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(pointer) % Arena::ALIGNMENT, 0);
+  for (size_t i = 0; i != 10000; ++i) {
+    arena.Allocate(40);
+  }
+  size_t n_reserved_bytes = arena.GetNReservedBytes();
+  arena.Reset();
+  ASSERT_EQ(arena.GetNAllocatedBytes(), 0);
+  for (size_t i = 0; i != 10001; ++i) {
+    arena.Allocate(40);
+  }
+  ASSERT_EQ(arena.GetNReservedBytes(), n_reserved_bytes);
+}
+
+TEST(HugePages, Default) {
+  Arena arena(true);
+  ASSERT_TRUE(arena.UsesHugePages());
+  void* pointer = arena.Allocate(40);
+  ASSERT_EQ(Arena::GetArena(pointer), &arena);
+  ASSERT_EQ(arena.GetNReservedBytes(), Arena::HUGE_PAGE_SIZE);
+}
+
+void AllocateMany(Arena* arena, std::vector<void*>* pointers, size_t n) {
+  for (size_t i = 0; i != n; ++i) {
+    pointers->push_back(arena->Allocate(64));
+  }
+}
+
+TEST(ConcurrentAllocate, Default) {
+  Arena arena;
+  size_t n_allocations = 10000;
+  std::vector<void*> first_pointers;
+  std::vector<void*> second_pointers;
+  std::thread first(AllocateMany, &arena, &first_pointers, n_allocations);
+  std::thread second(AllocateMany, &arena, &second_pointers, n_allocations);
+  first.join();
+  second.join();
+
+  std::set<void*> pointers(first_pointers.begin(), first_pointers.end());
+  pointers.insert(second_pointers.begin(), second_pointers.end());
+  ASSERT_EQ(pointers.size(), 2 * n_allocations);
+  ASSERT_EQ(arena.GetNAllocatedBytes(), 2 * n_allocations * 64);
+}
@@ -1,5 +1,6 @@
 #include "oaz/games/bandits.hpp"
 
+#include <random>
 #include <string>
 
 #include "gmock/gmock.h"
@@ -192,3 +193,28 @@ TEST(GameMap, InsertAlreadyInDB) {
   game_map->Insert(game, 1ll);
   ASSERT_EQ(game_map->GetSize(), 1);
 }
+
+TEST(UndoMove, RandomGames) {
+  std::mt19937 generator(0);
+  std::vector<size_t> available_moves;
+  for (size_t i = 0; i != 100; ++i) {
+    Bandits game;
+    std::vector<Bandits> positions;
+    std::vector<size_t> moves;
+    while (!game.IsFinished()) {
+      positions.push_back(game);
+      game.GetAvailableMoves(&available_moves);
+      std::uniform_int_distribution<size_t> distribution(
+          0, available_moves.size() - 1);
+      size_t move = available_moves[distribution(generator)];
+      game.PlayMove(move);
+      moves.push_back(move);
+    }
+    while (!moves.empty()) {
+      game.UndoMove(moves.back());
+      moves.pop_back();
+      ASSERT_TRUE(game == positions.back());
+      positions.pop_back();
+    }
+  }
+}
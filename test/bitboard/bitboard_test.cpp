@@ -43,6 +43,17 @@ TEST(Unset, Test23) {
   ASSERT_FALSE(board.Get(2, 3));
 }
 
+TEST(Unset, KeepsOtherSquares) {
+  BitBoard<4, 4> board;
+  board.Set(0, 0);
+  board.Set(2, 3);
+  board.Set(3, 3);
+  board.Unset(2, 3);
+  ASSERT_TRUE(board.Get(0, 0));
+  ASSERT_FALSE(board.Get(2, 3));
+  ASSERT_TRUE(board.Get(3, 3));
+}
+
 TEST(ColumnSum, Default) {
   BitBoard<4, 4> board;
   for (int i = 0; i != 4; ++i) board.Set(i, 1);
@@ -190,3 +201,19 @@ TEST(LexicographicComponentLength, DiagonalTest4) {
   BitBoard<6, 7> mask_board{{5, 0}, {4, 1}, {3, 2}, {2, 3}, {1, 4}, {0, 5}};
   ASSERT_EQ(board.LexicographicComponentLength(mask_board, 3, 2), 4);
 }
+
+TEST(LexicographicComponentLength, FirstSquare) {
+  BitBoard<6, 7> board{{0, 0}, {0, 1}, {0, 5}, {0, 6}};
+  BitBoard<6, 7> mask_board{{0, 0}, {0, 1}, {0, 2}, {0, 3},
+                            {0, 4}, {0, 5}, {0, 6}};
+  ASSERT_EQ(board.LexicographicComponentLength(mask_board, 0, 0), 2);
+}
+
+TEST(MirrorColumns, Default) {
+  BitBoard<6, 7> board{{0, 0}, {2, 1}, {5, 3}};
+  BitBoard<6, 7> mirror_board{{0, 6}, {2, 5}, {5, 3}};
+  ASSERT_TRUE(board.MirrorColumns() == mirror_board);
+  ASSERT_TRUE(mirror_board.MirrorColumns() == board);
+  BitBoard<6, 7> symmetric_board{{0, 2}, {0, 4}, {3, 3}};
+  ASSERT_TRUE(symmetric_board.MirrorColumns() == symmetric_board);
+}
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <boost/multi_array.hpp>
+#include <random>
 #include <string>
 
 #include "gmock/gmock.h"
@@ -302,3 +303,55 @@ TEST(GameMap, InsertAlreadyInDB) {
   game_map->Insert(game, 1ll);
   ASSERT_EQ(game_map->GetSize(), 1);
 }
+
+TEST(UndoMove, RandomGames) {
+  std::mt19937 generator(0);
+  std::vector<size_t> available_moves;
+  for (size_t i = 0; i != 100; ++i) {
+    ConnectFour game;
+    std::vector<ConnectFour> positions;
+    std::vector<size_t> moves;
+    while (!game.IsFinished()) {
+      positions.push_back(game);
+      game.GetAvailableMoves(&available_moves);
+      std::uniform_int_distribution<size_t> distribution(
+          0, available_moves.size() - 1);
+      size_t move = available_moves[distribution(generator)];
+      game.PlayMove(move);
+      moves.push_back(move);
+    }
+    while (!moves.empty()) {
+      game.UndoMove(moves.back());
+      moves.pop_back();
+      ASSERT_TRUE(game == positions.back());
+      positions.pop_back();
+    }
+  }
+}
+
+TEST(PlayMove, NoVictoryFromFirstSquare) {
+  ConnectFour game;
+  // The first player holds both ends of the bottom row, not four in a row
+  game.PlayFromString("5511620");
+  ASSERT_FALSE(game.IsFinished());
+}
+
+TEST(MirrorSymmetry, Default) {
+  ConnectFour game;
+  ASSERT_TRUE(game.IsMirrorSymmetric());
+  ASSERT_EQ(game.GetMirrorMove(0), 6);
+  ASSERT_EQ(game.GetMirrorMove(3), 3);
+  game.PlayFromString("33");
+  ASSERT_TRUE(game.IsMirrorSymmetric());
+  game.PlayMove(1);
+  ASSERT_FALSE(game.IsMirrorSymmetric());
+  // The tokens of the mirror columns belong to different players
+  game.PlayMove(5);
+  ASSERT_FALSE(game.IsMirrorSymmetric());
+
+  ConnectFour other_game;
+  other_game.PlayFromString("303");
+  ASSERT_FALSE(other_game.IsMirrorSymmetric());
+  other_game.PlayMove(6);
+  ASSERT_TRUE(other_game.IsMirrorSymmetric());
+}
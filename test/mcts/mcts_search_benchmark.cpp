@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "oaz/games/connect_four.hpp"
+#include "oaz/mcts/search.hpp"
+#include "oaz/mcts/selection.hpp"
+#include "oaz/simulation/simulation_evaluator.hpp"
+
+using namespace oaz::mcts;
+using namespace oaz::games;
+
+/* Measures the throughput of Search on Connect Four for an increasing number
+ * of threads. Two workloads are run: random playouts, as in mcts_search_test,
+ * and a constant evaluator that returns immediately, so that the cost of tree
+ * traversal and backpropagation dominates. Each is run with the dynamic
+ * Search and with SpecialisedSearch<ConnectFour, AZSelector>, the latter
+ * also with the statistics of the first two levels sharded per worker.
+ *
+ * Usage: mcts_search_benchmark [n_iterations] [max_n_threads] */
+
+namespace {
+
+class ConstantEvaluation : public oaz::evaluator::Evaluation {
+ public:
+  float GetValue() const override { return 0.; }
+  float GetPolicy(size_t) const override { return 1. / 7.; }
+  std::unique_ptr<oaz::evaluator::Evaluation> Clone() const override {
+    return std::make_unique<ConstantEvaluation>(*this);
+  }
+};
+
+class ConstantEvaluator : public oaz::evaluator::Evaluator {
+ public:
+  explicit ConstantEvaluator(
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool)
+      : m_thread_pool(std::move(thread_pool)) {}
+  void RequestEvaluation(
+      oaz::games::Game*,
+      std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
+      oaz::thread_pool::Task* task) override {
+    *evaluation = std::make_unique<ConstantEvaluation>();
+    m_thread_pool->enqueue(task);
+  }
+
+ private:
+  std::shared_ptr<oaz::thread_pool::ThreadPool> m_thread_pool;
+};
+
+template <class SearchT, class Evaluator>
+double RunSearch(size_t n_threads, size_t n_iterations, float virtual_loss,
+                 size_t n_sharded_levels = 0) {
+  auto pool = std::make_shared<oaz::thread_pool::ThreadPool>(n_threads);
+  auto evaluator = std::make_shared<Evaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<AZSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+      PlayerSearchProperties(evaluator, selector),
+      PlayerSearchProperties(evaluator, selector)};
+  SearchOptions options;
+  options.batch_size = 2 * n_threads;
+  options.n_iterations = n_iterations;
+  options.virtual_loss = virtual_loss;
+  options.n_sharded_levels = n_sharded_levels;
+  ConnectFour game;
+
+  auto start = std::chrono::steady_clock::now();
+  SearchT search(game, player_search_properties, pool, options);
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return n_iterations / elapsed.count();
+}
+
+template <class Evaluator>
+void RunWorkload(const char* name, size_t n_iterations, size_t max_n_threads) {
+  std::cout << name << std::endl;
+  std::cout << std::setw(10) << "threads" << std::setw(20) << "simulations/s"
+            << std::setw(20) << "with virtual loss" << std::setw(20)
+            << "specialised" << std::setw(20) << "with virtual loss"
+            << std::setw(20) << "sharded" << std::endl;
+  using Specialised = SpecialisedSearch<ConnectFour, AZSelector>;
+  for (size_t n_threads = 1; n_threads <= max_n_threads; n_threads *= 2) {
+    double throughput =
+        RunSearch<Search, Evaluator>(n_threads, n_iterations, 0.);
+    double throughput_virtual_loss =
+        RunSearch<Search, Evaluator>(n_threads, n_iterations, 1.);
+    double specialised_throughput =
+        RunSearch<Specialised, Evaluator>(n_threads, n_iterations, 0.);
+    double specialised_throughput_virtual_loss =
+        RunSearch<Specialised, Evaluator>(n_threads, n_iterations, 1.);
+    double sharded_throughput =
+        RunSearch<Specialised, Evaluator>(n_threads, n_iterations, 1., 2);
+    std::cout << std::setw(10) << n_threads << std::setw(20) << std::fixed
+              << std::setprecision(0) << throughput << std::setw(20)
+              << throughput_virtual_loss << std::setw(20)
+              << specialised_throughput << std::setw(20)
+              << specialised_throughput_virtual_loss << std::setw(20)
+              << sharded_throughput << std::endl;
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t n_iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  size_t max_n_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+
+  RunWorkload<oaz::simulation::SimulationEvaluator>("Random playouts",
+                                                    n_iterations,
+                                                    max_n_threads);
+  RunWorkload<ConstantEvaluator>("Constant evaluator", n_iterations,
+                                 max_n_threads);
+  return 0;
+}
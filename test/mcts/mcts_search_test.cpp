@@ -12,13 +12,22 @@
   friend class Search_CheckSearchTree_Test;              \
   friend class WaitingForEvaluation_Default_Test;
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 #include <vector>
 
 #include "oaz/games/connect_four.hpp"
+#include "oaz/mcts/multi_search.hpp"
 #include "oaz/mcts/search.hpp"
+#include "oaz/mcts/search_completion_queue.hpp"
 #include "oaz/mcts/selection.hpp"
 #include "oaz/simulation/simulation_evaluator.hpp"
 #include "oaz/utils/utils.hpp"
@@ -69,4 +78,1087 @@ TEST(MultithreadedSearch, CheckSearchTree) {
   ASSERT_EQ(tree_root->GetNVisits(), 1000);
   ASSERT_TRUE(CheckSearchTree(tree_root.get()));
 }
+
+TEST(Search, SubtreeReuse) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(1);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  Search search(game, player_search_properties, pool, 1, 100);
+  auto tree_root = search.GetTreeRoot();
+  SearchNode* child = tree_root->GetChild(3);
+  size_t move = child->GetMove();
+  size_t n_child_visits = child->GetNVisits();
+
+  auto subtree = AdvanceRoot(tree_root, move);
+  ASSERT_EQ(subtree.get(), child);
+  ASSERT_TRUE(subtree->IsRoot());
+  ASSERT_EQ(subtree->GetNVisits(), n_child_visits);
+  ASSERT_EQ(tree_root->GetNChildren(), 0);
+
+  game.PlayMove(move);
+  Search next_search(game, player_search_properties, pool, 1, 100, 0., 1.,
+                     subtree);
+  auto next_tree_root = next_search.GetTreeRoot();
+  ASSERT_EQ(next_tree_root.get(), child);
+  ASSERT_EQ(next_tree_root->GetNVisits(), 100);
+  ASSERT_TRUE(CheckSearchTree(next_tree_root.get()));
+}
+
+TEST(Search, Reclaimer) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(1);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  auto reclaimer = std::make_shared<oaz::reclaimer::Reclaimer>();
+  SearchOptions options;
+  options.n_iterations = 1000;
+  options.use_transpositions = true;
+  options.reclaimer = reclaimer;
+
+  // The siblings of the new root are returned to the arena by the reclaimer
+  auto search = std::make_unique<Search>(game, player_search_properties,
+                                         pool, options);
+  auto tree_root = search->GetTreeRoot();
+  auto* arena = oaz::arena::Arena::GetArena(tree_root.get());
+  size_t n_allocated_bytes = arena->GetNAllocatedBytes();
+  size_t move = tree_root->GetChild(3)->GetMove();
+  auto subtree = AdvanceRoot(tree_root, move, reclaimer);
+  ASSERT_TRUE(subtree->IsRoot());
+  ASSERT_EQ(tree_root->GetNChildren(), 0);
+  reclaimer->Wait();
+  ASSERT_LT(arena->GetNAllocatedBytes(), n_allocated_bytes);
+
+  // The tree is freed once the search and the other references are gone
+  std::weak_ptr<SearchNode> weak_tree_root = tree_root;
+  tree_root.reset();
+  subtree.reset();
+  search.reset();
+  reclaimer->Wait();
+  ASSERT_TRUE(weak_tree_root.expired());
+
+  // Trees outside of arenas
+  options.use_transpositions = false;
+  Search heap_search(game, player_search_properties, pool, options,
+                     std::make_shared<SearchNode>());
+  auto heap_tree_root = heap_search.GetTreeRoot();
+  SearchNode* child = heap_tree_root->GetChild(3);
+  size_t n_child_visits = child->GetNVisits();
+  auto heap_subtree =
+      AdvanceRoot(heap_tree_root, child->GetMove(), reclaimer);
+  ASSERT_EQ(heap_subtree->GetNVisits(), n_child_visits);
+  ASSERT_EQ(heap_tree_root->GetNChildren(), 0);
+  reclaimer->Wait();
+  ASSERT_TRUE(CheckSearchTree(heap_subtree.get()));
+}
+
+TEST(Search, AdvanceRootUnexpanded) {
+  auto root = std::make_shared<SearchNode>();
+  auto subtree = AdvanceRoot(root, 0);
+  ASSERT_TRUE(subtree->IsRoot());
+  ASSERT_EQ(subtree->GetNVisits(), 0);
+}
+
+TEST(Search, VirtualLoss) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<AZSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 16;
+  options.n_iterations = 1000;
+  options.virtual_loss = 3.;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), 1000);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  // All virtual losses have been reverted
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    SearchNode* child = tree_root->GetChild(i);
+    ASSERT_GE(child->GetAccumulatedValue(), -1e-3);
+    ASSERT_LE(child->GetAccumulatedValue(), child->GetNVisits() + 1e-3);
+  }
+}
+
+TEST(Search, ShardedStatistics) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 1000;
+  options.n_sharded_levels = 2;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_TRUE(tree_root->HasShardedStatistics());
+  ASSERT_TRUE(tree_root->GetChild(0)->HasShardedStatistics());
+  ASSERT_FALSE(tree_root->GetChild(0)->GetChild(0)->HasShardedStatistics());
+  ASSERT_EQ(tree_root->GetNVisits(), 1000);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+
+  // Sharded statistics are merged back when the siblings are freed
+  size_t move = tree_root->GetChild(0)->GetMove();
+  size_t n_child_visits = tree_root->GetChild(0)->GetNVisits();
+  auto subtree = AdvanceRoot(tree_root, move);
+  ASSERT_EQ(subtree->GetNVisits(), n_child_visits);
+}
+
+TEST(Search, TimeBudget) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 1000000000;
+  options.time_budget = 0.05;
+  auto start = std::chrono::steady_clock::now();
+  Search search(game, player_search_properties, pool, options);
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_LT(elapsed.count(), 5.);
+  ASSERT_GT(tree_root->GetNVisits(), 0);
+  ASSERT_LT(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+}
+
+TEST(Search, StopToken) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 1000000000;
+  options.stop_token = std::make_shared<StopToken>();
+  std::thread stopper([&options] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    options.stop_token->Stop();
+  });
+  Search search(game, player_search_properties, pool, options);
+  stopper.join();
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_LT(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+
+  // A search with a stopped token returns at once
+  Search stopped_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(stopped_search.GetTreeRoot()->GetNVisits(), 0);
+}
+TEST(Search, Launch) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 200;
+
+  auto search = Search::Launch(game, player_search_properties, pool, options);
+  search->Wait();
+  ASSERT_TRUE(search->IsDone());
+  auto tree_root = search->GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+
+  // A search with nothing to do is done at once
+  options.n_iterations = 0;
+  auto empty_search =
+      Search::Launch(game, player_search_properties, pool, options);
+  ASSERT_TRUE(empty_search->IsDone());
+}
+
+TEST(Search, CompletionQueue) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 2;
+  options.n_iterations = 100;
+
+  SearchCompletionQueue queue;
+  size_t n_searches = 16;
+  std::vector<std::shared_ptr<Search>> searches;
+  for (size_t i = 0; i != n_searches; ++i) {
+    searches.push_back(
+        Search::Launch(game, player_search_properties, pool, options, nullptr,
+                       [&queue, i] { queue.Push(i); }));
+  }
+
+  std::vector<bool> completed(n_searches, false);
+  for (size_t i = 0; i != n_searches; ++i) {
+    size_t key = queue.Pop();
+    ASSERT_FALSE(completed[key]);
+    completed[key] = true;
+    ASSERT_TRUE(searches[key]->IsDone());
+    auto tree_root = searches[key]->GetTreeRoot();
+    ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+    ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  }
+  size_t key;
+  ASSERT_FALSE(queue.TryPop(&key, 0.01));
+}
+
+TEST(Search, Reset) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 200;
+
+  Search search(game, player_search_properties, pool, options);
+  auto* arena = oaz::arena::Arena::GetArena(search.GetTreeRoot().get());
+
+  // Without other references to the tree, its arena is recycled
+  game.PlayMove(3);
+  search.Reset(game, 300);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_TRUE(search.IsDone());
+  ASSERT_EQ(tree_root->GetNVisits(), 300);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  ASSERT_EQ(oaz::arena::Arena::GetArena(tree_root.get()), arena);
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    ASSERT_EQ(tree_root->GetChild(i)->GetPlayer(), 1);
+  }
+
+  // A tree still referred to is left untouched
+  game.PlayMove(3);
+  search.Reset(game, 200);
+  ASSERT_NE(search.GetTreeRoot(), tree_root);
+  ASSERT_EQ(tree_root->GetNVisits(), 300);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  tree_root = nullptr;
+
+  // A given root is reused like that of a new search
+  auto root = SearchNode::CreateRoot(std::make_shared<oaz::arena::Arena>());
+  search.Reset(game, 100, root);
+  ASSERT_EQ(search.GetTreeRoot(), root);
+  ASSERT_EQ(root->GetNVisits(), 100);
+  search.Reset(game, 200, root);
+  ASSERT_EQ(root->GetNVisits(), 200);
+  ASSERT_TRUE(CheckSearchTree(root.get()));
+
+  auto launched_search =
+      Search::Launch(game, player_search_properties, pool, options);
+  launched_search->Wait();
+  // The callback is called again once the new search is done
+  SearchCompletionQueue queue;
+  launched_search->Relaunch(ConnectFour(), 300, nullptr,
+                            [&queue] { queue.Push(1); });
+  ASSERT_EQ(queue.Pop(), 1);
+  ASSERT_TRUE(launched_search->IsDone());
+  ASSERT_EQ(launched_search->GetTreeRoot()->GetNVisits(), 300);
+  ASSERT_TRUE(CheckSearchTree(launched_search->GetTreeRoot().get()));
+
+  // A search in progress cannot be reset
+  launched_search->Relaunch(game, 1000000, nullptr,
+                            [&queue] { queue.Push(2); });
+  ASSERT_THROW(launched_search->Reset(game, 100), std::logic_error);
+  launched_search->Stop();
+  ASSERT_EQ(queue.Pop(), 2);
+  ASSERT_TRUE(CheckSearchTree(launched_search->GetTreeRoot().get()));
+
+  SpecialisedSearch<ConnectFour, UCTSelector> specialised_search(
+      game, player_search_properties, pool, options);
+  specialised_search.Reset(ConnectFour(), 300);
+  ASSERT_EQ(specialised_search.GetTreeRoot()->GetNVisits(), 300);
+  ASSERT_TRUE(CheckSearchTree(specialised_search.GetTreeRoot().get()));
+}
+
+TEST(Search, MultiSearch) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  std::vector<ConnectFour> positions(5);
+  std::vector<const Game*> games;
+  for (size_t i = 0; i != positions.size(); ++i) {
+    positions[i].PlayMove(i);
+    games.push_back(&positions[i]);
+  }
+  SearchOptions options;
+  options.n_iterations = 200;
+  options.batch_size = 4;
+
+  for (size_t n_concurrent_searches : {0, 2}) {
+    MultiSearch multi_search(games, player_search_properties, pool, options,
+                             n_concurrent_searches);
+    ASSERT_EQ(multi_search.GetNSearches(), games.size());
+    for (size_t i = 0; i != games.size(); ++i) {
+      ASSERT_TRUE(multi_search.GetSearch(i).IsDone());
+      auto tree_root = multi_search.GetTreeRoot(i);
+      ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+      ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+      // The visit of the root itself is not attributed to any move
+      std::vector<size_t> n_visits = multi_search.GetVisits(i, 7);
+      size_t total_n_visits = 0;
+      for (size_t n : n_visits) {
+        total_n_visits += n;
+      }
+      ASSERT_EQ(total_n_visits, options.n_iterations - 1);
+    }
+  }
+
+  // Subtrees are reused per position
+  MultiSearch multi_search(games, player_search_properties, pool, options);
+  std::vector<std::shared_ptr<SearchNode>> roots;
+  for (size_t i = 0; i != games.size(); ++i) {
+    roots.push_back(multi_search.GetTreeRoot(i));
+  }
+  options.n_iterations = 300;
+  MultiSearch next_multi_search(games, player_search_properties, pool,
+                                options, 2, roots);
+  for (size_t i = 0; i != games.size(); ++i) {
+    ASSERT_EQ(next_multi_search.GetTreeRoot(i), roots[i]);
+    ASSERT_EQ(roots[i]->GetNVisits(), options.n_iterations);
+  }
+  ASSERT_THROW(MultiSearch(games, player_search_properties, pool, options, 0,
+                           {roots[0]}),
+               std::invalid_argument);
+}
+
+TEST(Search, DestroyBeforeDone) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  ConnectFour game;
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  auto player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 1000000000;
+
+  auto search = Search::Launch(game, player_search_properties, pool, options);
+  auto tree_root = search->GetTreeRoot();
+  search.reset();
+  ASSERT_LT(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+}
+namespace {
+/* Records the positions it is asked to evaluate */
+class RecordingEvaluator : public oaz::evaluator::Evaluator {
+ public:
+  explicit RecordingEvaluator(
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool)
+      : m_evaluator(thread_pool) {}
+
+  void RequestEvaluation(
+      oaz::games::Game* game,
+      std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
+      oaz::thread_pool::Task* task) override {
+    if (game->IsFinished()) {
+      ++m_n_finished_requests;
+    } else {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_states.push_back(static_cast<ConnectFour*>(game)->GetState());
+    }
+    m_evaluator.RequestEvaluation(game, evaluation, task);
+  }
+
+  void RequestEvaluations(
+      const std::vector<oaz::games::Game*>& games,
+      const std::vector<std::unique_ptr<oaz::evaluator::Evaluation>*>&
+          evaluations,
+      const std::vector<oaz::thread_pool::Task*>& tasks) override {
+    size_t group_size = games.size();
+    size_t max_group_size = m_max_group_size;
+    while (group_size > max_group_size &&
+           !m_max_group_size.compare_exchange_weak(max_group_size,
+                                                   group_size)) {
+    }
+    Evaluator::RequestEvaluations(games, evaluations, tasks);
+  }
+
+  size_t GetMaxGroupSize() const { return m_max_group_size; }
+
+  size_t GetNRequests() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_states.size() + m_n_finished_requests;
+  }
+
+  size_t GetNFinishedRequests() const { return m_n_finished_requests; }
+
+  size_t GetNDuplicates() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::set<uint64_t> unique_states(m_states.begin(), m_states.end());
+    return m_states.size() - unique_states.size();
+  }
+
+ private:
+  oaz::simulation::SimulationEvaluator m_evaluator;
+  std::vector<uint64_t> m_states;
+  std::atomic<size_t> m_n_finished_requests{0};
+  std::atomic<size_t> m_max_group_size{0};
+  std::mutex m_mutex;
+};
+
+/* Evaluates every position as a draw, so that only finished games tell the
+ * children of a node apart */
+class NeutralEvaluator : public oaz::evaluator::Evaluator {
+ public:
+  explicit NeutralEvaluator(
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool)
+      : m_thread_pool(std::move(thread_pool)) {}
+
+  void RequestEvaluation(
+      oaz::games::Game* game,
+      std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
+      oaz::thread_pool::Task* task) override {
+    *evaluation = std::make_unique<oaz::simulation::SimulationEvaluation>(0.);
+    m_thread_pool->enqueue(task);
+  }
+
+ private:
+  std::shared_ptr<oaz::thread_pool::ThreadPool> m_thread_pool;
+};
+
+void CollectAliasVisits(SearchNode* node,
+                        std::map<SearchNode*, size_t>* alias_visits) {
+  if (node->IsAlias()) {
+    (*alias_visits)[node->GetAliasTarget()] += node->GetNVisits();
+  }
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    CollectAliasVisits(node->GetChild(i), alias_visits);
+  }
+}
+
+/* Like CheckSearchTree, except that the visits a node receives through its
+ * aliases are not counted as visits from its parent */
+bool CheckSearchGraph(SearchNode* node,
+                      const std::map<SearchNode*, size_t>& alias_visits) {
+  if (node->IsLeaf()) {
+    return true;
+  }
+  size_t n_children_visits = 0;
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    SearchNode* child = node->GetChild(i);
+    n_children_visits += child->GetNVisits();
+    auto iterator = alias_visits.find(child);
+    if (iterator != alias_visits.end()) {
+      n_children_visits -= iterator->second;
+    }
+    if (!CheckSearchGraph(child, alias_visits)) {
+      return false;
+    }
+  }
+  return node->GetNVisits() == n_children_visits + 1;
+}
+}  // namespace
+
+TEST(Search, Transpositions) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  ConnectFour game;
+  SearchOptions options;
+  options.batch_size = 4;
+  options.n_iterations = 3000;
+
+  auto evaluator = make_shared<RecordingEvaluator>(pool);
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  options.use_transpositions = true;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  std::map<SearchNode*, size_t> alias_visits;
+  CollectAliasVisits(tree_root.get(), &alias_visits);
+  ASSERT_FALSE(alias_visits.empty());
+  ASSERT_TRUE(CheckSearchGraph(tree_root.get(), alias_visits));
+  ASSERT_EQ(evaluator->GetNDuplicates(), 0);
+
+  // Aliases to the subtrees that are freed are cleared
+  size_t move = tree_root->GetChild(3)->GetMove();
+  auto subtree = AdvanceRoot(tree_root, move);
+  game.PlayMove(move);
+  Search next_search(game, player_search_properties, pool, options, subtree);
+  ASSERT_EQ(subtree->GetNVisits(), options.n_iterations);
+
+  // Without transpositions, positions are evaluated repeatedly
+  auto tree_evaluator = make_shared<RecordingEvaluator>(pool);
+  player_search_properties = {
+    PlayerSearchProperties(tree_evaluator, selector),
+    PlayerSearchProperties(tree_evaluator, selector)
+  };
+  options.use_transpositions = false;
+  ConnectFour new_game;
+  Search tree_search(new_game, player_search_properties, pool, options);
+  ASSERT_GT(tree_evaluator->GetNDuplicates(), 0);
+}
+
+TEST(Search, TerminalShortCircuit) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<RecordingEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  // The first player wins by playing in the first column
+  ConnectFour game;
+  for (size_t move : {0, 1, 0, 1, 0, 1}) {
+    game.PlayMove(move);
+  }
+  SearchOptions options;
+  options.n_iterations = 500;
+  options.batch_size = 4;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  // Finished games are scored by the search itself
+  ASSERT_EQ(evaluator->GetNFinishedRequests(), 0);
+  ASSERT_LT(evaluator->GetNRequests(), options.n_iterations);
+
+  SearchNode* winning_child = nullptr;
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    if (tree_root->GetChild(i)->GetMove() == 0) {
+      winning_child = tree_root->GetChild(i);
+    }
+  }
+  ASSERT_NE(winning_child, nullptr);
+  ASSERT_GT(winning_child->GetNVisits(), 0);
+  ASSERT_FLOAT_EQ(winning_child->GetAccumulatedValue(),
+                  static_cast<float>(winning_child->GetNVisits()));
+
+  // A search from a finished game never reaches the evaluator
+  game.PlayMove(0);
+  Search finished_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(finished_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_EQ(evaluator->GetNFinishedRequests(), 0);
+}
+
+TEST(Search, Solver) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  // The first player wins by playing in the first column
+  ConnectFour game;
+  for (size_t move : {0, 1, 0, 1, 0, 1}) {
+    game.PlayMove(move);
+  }
+  SearchOptions options;
+  options.n_iterations = 10000;
+  options.batch_size = 4;
+  options.use_solver = true;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  // The player to move wins, so the player who moved to the root loses
+  ASSERT_EQ(tree_root->GetProvenValue(), ProvenValue::LOSS);
+  ASSERT_EQ(tree_root->GetNVisits() + search.GetNSavedIterations(),
+            options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    SearchNode* child = tree_root->GetChild(i);
+    if (child->GetMove() == 0) {
+      ASSERT_EQ(child->GetProvenValue(), ProvenValue::WIN);
+    }
+  }
+
+  // The first player threatens to win on both sides of the bottom row: the
+  // second player loses whatever they play
+  ConnectFour losing_game;
+  for (size_t move : {3, 3, 2, 2, 4}) {
+    losing_game.PlayMove(move);
+  }
+  Search losing_search(losing_game, player_search_properties, pool, options);
+  tree_root = losing_search.GetTreeRoot();
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  ASSERT_LT(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_EQ(tree_root->GetProvenValue(), ProvenValue::WIN);
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    ASSERT_EQ(tree_root->GetChild(i)->GetProvenValue(), ProvenValue::LOSS);
+  }
+
+  // Without the solver, the whole budget is spent
+  options.use_solver = false;
+  options.n_iterations = 500;
+  Search unsolved_search(losing_game, player_search_properties, pool,
+                         options);
+  ASSERT_EQ(unsolved_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_FALSE(unsolved_search.GetTreeRoot()->IsProven());
+}
+
+TEST(Search, StopWhenDecided) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  // The first player wins by playing in the first column
+  ConnectFour game;
+  for (size_t move : {0, 1, 0, 1, 0, 1}) {
+    game.PlayMove(move);
+  }
+  SearchOptions options;
+  options.n_iterations = 2000;
+  options.batch_size = 4;
+  options.stop_when_decided = true;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  ASSERT_GT(search.GetNSavedIterations(), 0);
+  ASSERT_EQ(tree_root->GetNVisits() + search.GetNSavedIterations(),
+            options.n_iterations);
+
+  // The saved iterations could not have changed the most visited child
+  std::vector<size_t> n_visits;
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    n_visits.push_back(tree_root->GetChild(i)->GetNVisits());
+  }
+  std::sort(n_visits.rbegin(), n_visits.rend());
+  ASSERT_GT(n_visits[0], n_visits[1] + search.GetNSavedIterations());
+
+  options.stop_when_decided = false;
+  Search full_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(full_search.GetNSavedIterations(), 0);
+  ASSERT_EQ(full_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+}
+
+/* Value 0, with priors increasing with the move */
+class SkewedEvaluation : public oaz::evaluator::Evaluation {
+ public:
+  float GetValue() const override { return 0.; }
+  float GetPolicy(size_t move) const override { return (move + 1.) / 28.; }
+  std::unique_ptr<oaz::evaluator::Evaluation> Clone() const override {
+    return std::make_unique<SkewedEvaluation>(*this);
+  }
+};
+
+class SkewedEvaluator : public oaz::evaluator::Evaluator {
+ public:
+  explicit SkewedEvaluator(
+      std::shared_ptr<oaz::thread_pool::ThreadPool> thread_pool)
+      : m_thread_pool(std::move(thread_pool)) {}
+
+  void RequestEvaluation(
+      oaz::games::Game* game,
+      std::unique_ptr<oaz::evaluator::Evaluation>* evaluation,
+      oaz::thread_pool::Task* task) override {
+    *evaluation = std::make_unique<SkewedEvaluation>();
+    m_thread_pool->enqueue(task);
+  }
+
+ private:
+  std::shared_ptr<oaz::thread_pool::ThreadPool> m_thread_pool;
+};
+
+/* Checks that children are ordered by decreasing prior, and that only those
+ * within the widening limit were built and visited */
+bool CheckWidening(SearchNode* node, const SearchOptions& options) {
+  auto width = static_cast<size_t>(
+      std::ceil(options.widening_constant *
+                std::pow(static_cast<float>(node->GetNVisits()),
+                         options.widening_exponent)));
+  if (node->GetNChildren() > std::max(width, size_t(1))) {
+    return false;
+  }
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    SearchNode* child = node->GetChild(i);
+    if (i != 0 && child->GetPrior() > node->GetChild(i - 1)->GetPrior()) {
+      return false;
+    }
+    if (i >= std::max(width, size_t(1)) && child->GetNVisits() != 0) {
+      return false;
+    }
+    if (!CheckWidening(child, options)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(Search, ProgressiveWidening) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<SkewedEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<AZSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.n_iterations = 1000;
+  options.batch_size = 4;
+  options.widening_constant = 0.5;
+  options.widening_exponent = 0.25;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  ASSERT_TRUE(CheckWidening(tree_root.get(), options));
+  // The most likely move comes first, and the least likely one is never built
+  ASSERT_EQ(tree_root->GetChild(0)->GetMove(), 6);
+  ASSERT_EQ(tree_root->GetNMoves(), 7);
+  ASSERT_LT(tree_root->GetNChildren(), 7);
+  ASSERT_EQ(tree_root->GetChildMove(6), 0);
+
+  options.use_transpositions = true;
+  options.use_solver = true;
+  options.batch_size = 8;
+  Search transposition_search(game, player_search_properties, pool, options);
+  tree_root = transposition_search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  std::map<SearchNode*, size_t> alias_visits;
+  CollectAliasVisits(tree_root.get(), &alias_visits);
+  ASSERT_TRUE(CheckSearchGraph(tree_root.get(), alias_visits));
+  ASSERT_TRUE(CheckWidening(tree_root.get(), options));
+}
+
+TEST(Search, GroupedSelection) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<RecordingEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.n_iterations = 2000;
+  options.batch_size = 8;
+  options.n_leaves_per_task = 4;
+  options.virtual_loss = 1.;
+  Search search(game, player_search_properties, pool, options);
+  ASSERT_EQ(search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(search.GetTreeRoot().get()));
+  ASSERT_GT(evaluator->GetMaxGroupSize(), 1);
+  ASSERT_LE(evaluator->GetMaxGroupSize(), options.n_leaves_per_task);
+
+  // Without virtual loss, selections of a pass reaching the same leaf wait
+  // for it
+  options.virtual_loss = 0.;
+  Search waiting_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(waiting_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(waiting_search.GetTreeRoot().get()));
+
+  // Finished games are backpropagated within the pass
+  for (size_t move : {0, 1, 0, 1, 0, 1}) {
+    game.PlayMove(move);
+  }
+  options.virtual_loss = 1.;
+  Search endgame_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(endgame_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(endgame_search.GetTreeRoot().get()));
+  ASSERT_EQ(evaluator->GetNFinishedRequests(), 0);
+}
+
+TEST(Search, LargeBatch) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  // Without virtual loss, most of the selections wait on the same few leaves
+  SearchOptions options;
+  options.n_iterations = 20000;
+  options.batch_size = 2048;
+  Search search(game, player_search_properties, pool, options);
+  ASSERT_EQ(search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(search.GetTreeRoot().get()));
+
+  options.n_leaves_per_task = 16;
+  Search grouped_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(grouped_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(grouped_search.GetTreeRoot().get()));
+
+  options.batch_size = SearchNode::MAX_N_WAITERS + 1;
+  ASSERT_THROW(Search(game, player_search_properties, pool, options),
+               std::invalid_argument);
+}
+
+TEST(Search, GumbelRoot) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<NeutralEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<GumbelSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  // The first player wins by playing in the first column
+  ConnectFour game;
+  for (size_t move : {0, 1, 0, 1, 0, 1}) {
+    game.PlayMove(move);
+  }
+  for (size_t batch_size : {1, 4}) {
+    // A handful of simulations is enough to find the win
+    Search search(game, player_search_properties, pool, batch_size, 16);
+    auto tree_root = search.GetTreeRoot();
+    ASSERT_EQ(tree_root->GetNVisits(), 16);
+    ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+    ASSERT_TRUE(search.HasGumbelRoot());
+    ASSERT_EQ(search.GetGumbelMove(), 0);
+    std::vector<float> policy = search.GetImprovedPolicy();
+    ASSERT_EQ(policy.size(), tree_root->GetNChildren());
+    size_t best_child_index =
+        std::max_element(policy.begin(), policy.end()) - policy.begin();
+    ASSERT_EQ(tree_root->GetChild(best_child_index)->GetMove(), 0);
+  }
+
+  // Other selectors leave the root to them
+  std::shared_ptr<Selector> uct_selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> uct_player_search_properties = {
+    PlayerSearchProperties(evaluator, uct_selector),
+    PlayerSearchProperties(evaluator, uct_selector)
+  };
+  Search uct_search(game, uct_player_search_properties, pool, 1, 16);
+  ASSERT_FALSE(uct_search.HasGumbelRoot());
+  ASSERT_THROW(uct_search.GetGumbelMove(), std::logic_error);
+}
+
+TEST(Search, Specialised) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(1);
+  auto evaluator = make_shared<SkewedEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<AZSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.n_iterations = 1000;
+  options.batch_size = 1;
+
+  // With a single selection and a deterministic evaluator, the specialised
+  // descent builds the same tree
+  Search search(game, player_search_properties, pool, options);
+  SpecialisedSearch<ConnectFour, AZSelector> specialised_search(
+      game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  auto specialised_tree_root = specialised_search.GetTreeRoot();
+  ASSERT_EQ(specialised_tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(specialised_tree_root.get()));
+  ASSERT_EQ(specialised_tree_root->GetNChildren(), tree_root->GetNChildren());
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    ASSERT_EQ(specialised_tree_root->GetChild(i)->GetNVisits(),
+              tree_root->GetChild(i)->GetNVisits());
+  }
+
+  auto launched_search = SpecialisedSearch<ConnectFour, AZSelector>::Launch(
+      game, player_search_properties, pool, options);
+  launched_search->Wait();
+  ASSERT_EQ(launched_search->GetTreeRoot()->GetNVisits(),
+            options.n_iterations);
+
+  ASSERT_THROW((SpecialisedSearch<ConnectFour, UCTSelector>(
+                   game, player_search_properties, pool, options)),
+               std::invalid_argument);
+}
+
+size_t CountTreeNodes(SearchNode* node) {
+  size_t n_nodes = 0;
+  for (size_t i = 0; i != node->GetNChildren(); ++i) {
+    n_nodes += 1 + CountTreeNodes(node->GetChild(i));
+  }
+  return n_nodes;
+}
+
+TEST(Search, NodeLimit) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.n_iterations = 5000;
+  options.batch_size = 4;
+  options.virtual_loss = 1.;
+  options.max_n_nodes = 2000;
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_GT(search.GetNPrunings(), 0);
+  // Expansions in flight add at most one set of children each
+  ASSERT_LE(CountTreeNodes(tree_root.get()),
+            options.max_n_nodes + options.batch_size * 7);
+
+  options.n_leaves_per_task = 2;
+  Search grouped_search(game, player_search_properties, pool, options);
+  ASSERT_EQ(grouped_search.GetTreeRoot()->GetNVisits(), options.n_iterations);
+  ASSERT_GT(grouped_search.GetNPrunings(), 0);
+  ASSERT_LE(CountTreeNodes(grouped_search.GetTreeRoot().get()),
+            options.max_n_nodes + options.batch_size * 7);
+
+  options.use_transpositions = true;
+  ASSERT_THROW(Search(game, player_search_properties, pool, options),
+               std::invalid_argument);
+}
+
+TEST(Search, NodeLimitBoundsMemory) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(8);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.n_iterations = 40000;
+  options.batch_size = 8;
+  options.virtual_loss = 1.;
+  options.max_n_nodes = 2000;
+  Search search(game, player_search_properties, pool, options);
+  auto* arena = oaz::arena::Arena::GetArena(search.GetTreeRoot().get());
+  ASSERT_GT(search.GetNPrunings(), 10);
+  // Blocks freed by pruning are reused whichever worker frees them, so the
+  // arena holds about one slab per shard on top of the capped tree
+  ASSERT_LE(arena->GetNReservedBytes(),
+            oaz::arena::Arena::N_SHARDS * oaz::arena::Arena::SLAB_SIZE +
+                4 * options.max_n_nodes * sizeof(SearchNode));
+}
+
+TEST(Search, SharedNodeBudget) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  auto node_budget = std::make_shared<NodeBudget>(3000);
+  SearchOptions options;
+  options.n_iterations = 4000;
+  options.batch_size = 2;
+  options.node_budget = node_budget;
+  std::vector<std::shared_ptr<Search>> searches;
+  for (size_t i = 0; i != 4; ++i) {
+    searches.push_back(
+        Search::Launch(game, player_search_properties, pool, options));
+  }
+  size_t n_nodes = 0;
+  size_t n_prunings = 0;
+  for (auto& search : searches) {
+    search->Wait();
+    ASSERT_EQ(search->GetTreeRoot()->GetNVisits(), options.n_iterations);
+    n_nodes += CountTreeNodes(search->GetTreeRoot().get());
+    n_prunings += search->GetNPrunings();
+  }
+  ASSERT_GT(n_prunings, 0);
+  ASSERT_EQ(node_budget->GetNNodes(), n_nodes);
+  ASSERT_LE(n_nodes,
+            node_budget->GetMaxNNodes() + searches.size() *
+                                              options.batch_size * 7);
+  searches.clear();
+  ASSERT_EQ(node_budget->GetNNodes(), 0);
+}
+
+TEST(Search, FoldSymmetries) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<SkewedEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<AZSelector>();
+  std::vector<PlayerSearchProperties> player_search_properties = {
+    PlayerSearchProperties(evaluator, selector),
+    PlayerSearchProperties(evaluator, selector)
+  };
+  ConnectFour game;
+  SearchOptions options;
+  options.n_iterations = 300;
+  options.batch_size = 4;
+  options.fold_symmetries = true;
+
+  // The empty board is its own mirror image: each child of the root stands
+  // for a column and its mirror column
+  Search search(game, player_search_properties, pool, options);
+  auto tree_root = search.GetTreeRoot();
+  ASSERT_EQ(tree_root->GetNVisits(), options.n_iterations);
+  ASSERT_TRUE(CheckSearchTree(tree_root.get()));
+  ASSERT_EQ(tree_root->GetNChildren(), 4);
+  for (size_t i = 0; i != tree_root->GetNChildren(); ++i) {
+    SearchNode* child = tree_root->GetChild(i);
+    ASSERT_EQ(child->GetMove(), i);
+    float prior = i == 3 ? 4. / 28. : 8. / 28.;
+    ASSERT_FLOAT_EQ(child->GetPrior(), prior);
+    // Only the root is folded
+    ASSERT_TRUE(child->GetNChildren() == 0 || child->GetNChildren() == 7);
+  }
+  std::vector<std::pair<size_t, size_t>> folded_moves = {
+    {0, 6}, {1, 5}, {2, 4}
+  };
+  ASSERT_EQ(search.GetFoldedMoves(), folded_moves);
+  std::vector<float> policy = {0.2, 0.4, 0.2, 0.2, 0., 0., 0.};
+  search.UnfoldPolicy(&policy);
+  ASSERT_THAT(policy, testing::ElementsAre(0.1, 0.2, 0.1, 0.2, 0.1, 0.2, 0.1));
+
+  // The visits of a folded child are split with its mirror move
+  MultiSearch multi_search({&game}, player_search_properties, pool, options);
+  std::vector<size_t> n_visits = multi_search.GetVisits(0, 7);
+  for (size_t move = 0; move != 3; ++move) {
+    SearchNode* child = multi_search.GetTreeRoot(0)->GetChild(move);
+    ASSERT_EQ(n_visits[move] + n_visits[6 - move], child->GetNVisits());
+    ASSERT_LE(n_visits[move] - n_visits[6 - move], 1);
+  }
+
+  // Positions without the symmetry, or searches without the option, are not
+  // folded
+  game.PlayMove(0);
+  search.Reset(game, options.n_iterations);
+  ASSERT_EQ(search.GetTreeRoot()->GetNChildren(), 7);
+  ASSERT_TRUE(search.GetFoldedMoves().empty());
+  options.fold_symmetries = false;
+  Search unfolded_search(ConnectFour(), player_search_properties, pool,
+                         options);
+  ASSERT_EQ(unfolded_search.GetTreeRoot()->GetNChildren(), 7);
+  ASSERT_TRUE(unfolded_search.GetFoldedMoves().empty());
+}
 }  // namespace oaz::mcts
@@ -1,5 +1,7 @@
 #include <iostream>
+#include <limits>
 #include <random>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -46,3 +48,195 @@ TEST(SamplingTest, LargeSampleEqualProbabilities) {
   }
   std::cout << "Counts: " << count0 << " " << count1 << std::endl;
 }
+
+namespace {
+void FillRandomChildren(SearchNode* root, size_t n_children,
+                        std::mt19937* generator) {
+  std::uniform_real_distribution<float> prior_distribution(0., 1.);
+  std::uniform_int_distribution<size_t> visits_distribution(0, 20);
+  for (size_t i = 0; i != n_children; ++i) {
+    root->AddChild(i, 0, prior_distribution(*generator));
+    SearchNode* child = root->GetChild(i);
+    size_t n_visits = visits_distribution(*generator);
+    for (size_t j = 0; j != n_visits; ++j) {
+      child->IncrementNVisits();
+      root->IncrementNVisits();
+      child->AddValue(prior_distribution(*generator));
+    }
+  }
+}
+
+std::vector<InstructionSet> GetSupportedInstructionSets() {
+  std::vector<InstructionSet> instruction_sets{InstructionSet::SCALAR};
+  if (GetInstructionSet() != InstructionSet::SCALAR) {
+    instruction_sets.push_back(InstructionSet::AVX2);
+  }
+  if (GetInstructionSet() == InstructionSet::AVX512) {
+    instruction_sets.push_back(InstructionSet::AVX512);
+  }
+  return instruction_sets;
+}
+}  // namespace
+
+TEST(VectorisedSelection, ScoresMatchScalar) {
+  std::mt19937 generator(0);
+  for (size_t n_children = 1; n_children != 40; ++n_children) {
+    SearchNode root;
+    FillRandomChildren(&root, n_children, &generator);
+    ChildStatistics statistics;
+    statistics.Load(&root);
+    std::vector<float> expected(n_children);
+    kernels::ComputeScoresScalar(0, n_children, statistics.GetNVisits(),
+                                 statistics.GetAccumulatedValues(),
+                                 statistics.GetPriors(), 2., expected.data());
+    for (InstructionSet instruction_set : GetSupportedInstructionSets()) {
+      kernels::ComputeScores(instruction_set, n_children,
+                             statistics.GetNVisits(),
+                             statistics.GetAccumulatedValues(),
+                             statistics.GetPriors(), 2.,
+                             statistics.GetScores());
+      for (size_t i = 0; i != n_children; ++i) {
+        ASSERT_FLOAT_EQ(statistics.GetScores()[i], expected[i]);
+      }
+    }
+  }
+}
+
+TEST(VectorisedSelection, ArgMaxReturnsFirstMaximum) {
+  std::vector<float> scores(37, 0.5);
+  scores[21] = 2.;
+  scores[33] = 2.;
+  for (InstructionSet instruction_set : GetSupportedInstructionSets()) {
+    ASSERT_EQ(kernels::ArgMax(instruction_set, scores.size(), scores.data()),
+              21);
+    ASSERT_EQ(kernels::ArgMax(instruction_set, 21, scores.data()), 0);
+  }
+  std::vector<float> negative_scores(19, -1.);
+  negative_scores[7] = -0.5;
+  std::vector<float> excluded_scores(19,
+                                     -std::numeric_limits<float>::infinity());
+  for (InstructionSet instruction_set : GetSupportedInstructionSets()) {
+    ASSERT_EQ(kernels::ArgMax(instruction_set, negative_scores.size(),
+                              negative_scores.data()),
+              7);
+    ASSERT_EQ(kernels::ArgMax(instruction_set, excluded_scores.size(),
+                              excluded_scores.data()),
+              0);
+  }
+}
+
+TEST(VectorisedSelection, AZSelectorMatchesScalar) {
+  std::mt19937 generator(1);
+  AZSelector scalar_selector;
+  AZSelector vectorised_selector(true);
+  for (size_t n_children = 1; n_children != 100; ++n_children) {
+    SearchNode root;
+    FillRandomChildren(&root, n_children, &generator);
+    size_t expected = scalar_selector(&root);
+    size_t index = vectorised_selector(&root);
+    // Scores may differ in the last bit, so that ties can be broken
+    // differently, but the selected child must have the maximal score
+    ChildStatistics statistics;
+    statistics.Load(&root);
+    float scale = C_EXPLORATION * std::sqrt(root.GetNVisits());
+    std::vector<float> scores(n_children);
+    kernels::ComputeScoresScalar(0, n_children, statistics.GetNVisits(),
+                                 statistics.GetAccumulatedValues(),
+                                 statistics.GetPriors(), scale, scores.data());
+    ASSERT_NEAR(scores[index], scores[expected], 1e-5);
+  }
+}
+
+TEST(VectorisedSelection, UCTSelectorMatchesScalar) {
+  std::mt19937 generator(2);
+  UCTSelector scalar_selector;
+  UCTSelector vectorised_selector(true);
+  for (size_t n_children = 1; n_children != 100; ++n_children) {
+    SearchNode root;
+    FillRandomChildren(&root, n_children, &generator);
+    size_t expected = scalar_selector(&root);
+    size_t index = vectorised_selector(&root);
+    ChildStatistics statistics;
+    statistics.Load(&root);
+    float scale =
+        C_EXPLORATION * std::sqrt(std::log(static_cast<float>(root.GetNVisits())));
+    std::vector<float> scores(n_children);
+    kernels::ComputeScoresScalar(0, n_children, statistics.GetNVisits(),
+                                 statistics.GetAccumulatedValues(), nullptr,
+                                 scale, scores.data());
+    ASSERT_NEAR(scores[index], scores[expected], 1e-5);
+  }
+}
+
+TEST(Selection, SkipsProvenChildren) {
+  std::mt19937 generator(0);
+  SearchNode root;
+  FillRandomChildren(&root, 20, &generator);
+  std::vector<std::unique_ptr<Selector>> selectors;
+  selectors.push_back(std::make_unique<UCTSelector>());
+  selectors.push_back(std::make_unique<AZSelector>());
+  selectors.push_back(std::make_unique<UCTSelector>(true));
+  selectors.push_back(std::make_unique<AZSelector>(true));
+  selectors.push_back(std::make_unique<GumbelSelector>());
+  for (auto& selector : selectors) {
+    root.GetChild((*selector)(&root))->SetProvenValue(ProvenValue::LOSS);
+  }
+  for (auto& selector : selectors) {
+    ASSERT_FALSE(root.GetChild((*selector)(&root))->IsProven());
+  }
+}
+
+TEST(Selection, SkipsProvenChildrenWithNonPositiveScores) {
+  // Under virtual loss, every unproven child may score below 0: the proven
+  // first child must still not be selected
+  SearchNode root;
+  for (size_t i = 0; i != 20; ++i) {
+    root.AddChild(i, 0, 0.);
+    SearchNode* child = root.GetChild(i);
+    for (size_t j = 0; j != 4; ++j) {
+      child->IncrementNVisits();
+      root.IncrementNVisits();
+      child->AddValue(i == 0 ? 1. : -1. - 0.01 * i);
+    }
+  }
+  root.GetChild(0)->SetProvenValue(ProvenValue::WIN);
+  std::vector<std::unique_ptr<Selector>> selectors;
+  selectors.push_back(std::make_unique<UCTSelector>());
+  selectors.push_back(std::make_unique<AZSelector>());
+  selectors.push_back(std::make_unique<UCTSelector>(true));
+  selectors.push_back(std::make_unique<AZSelector>(true));
+  for (auto& selector : selectors) {
+    ASSERT_EQ((*selector)(&root), 1);
+  }
+}
+
+TEST(GumbelSelection, ImprovedPolicy) {
+  GumbelSelector selector;
+  SearchNode root;
+  root.AddChild(0, 0, 0.5F);
+  root.AddChild(1, 0, 0.5F);
+  root.AddChild(2, 0, 0.F);
+  std::vector<float> policy;
+  selector.GetImprovedPolicy(&root, root.GetNChildren(), &policy);
+  ASSERT_FLOAT_EQ(policy[0], 0.5);
+  ASSERT_FLOAT_EQ(policy[1], 0.5);
+  ASSERT_LT(policy[2], 1e-6);
+
+  // Values take over from priors once children are visited
+  root.GetChild(0)->IncrementNVisits();
+  root.GetChild(1)->IncrementNVisits();
+  root.GetChild(1)->AddValue(1.F);
+  selector.GetImprovedPolicy(&root, root.GetNChildren(), &policy);
+  ASSERT_GT(policy[1], 0.99);
+  ASSERT_NEAR(policy[0] + policy[1] + policy[2], 1., 1e-5);
+  ASSERT_EQ(selector(&root), 1);
+  ASSERT_EQ(selector(&root, 1), 0);
+
+  // Visits catch up with the improved policy
+  for (size_t i = 0; i != 100; ++i) {
+    root.GetChild(1)->IncrementNVisits();
+    root.GetChild(1)->AddValue(1.F);
+  }
+  root.GetChild(0)->AddValue(0.99F);
+  ASSERT_EQ(selector(&root), 0);
+}
@@ -1,9 +1,13 @@
+#include <iostream>
 #include <random>
+#include <thread>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "oaz/mcts/search_node.hpp"
 #include "oaz/mcts/selection.hpp"
+#include "oaz/thread_pool/thread_pool.hpp"
 
 using namespace oaz::mcts;
 using namespace testing;
@@ -128,3 +132,218 @@ TEST(PriorIterator, TwoChildren) {
   ASSERT_EQ(*(++root.GetPriorCBegin()), 0.6F);
 }
 
+
+TEST(Arena, AddChild) {
+  auto root = SearchNode::CreateRoot(std::make_shared<oaz::arena::Arena>());
+  ASSERT_TRUE(root->IsInArena());
+  root->ReserveChildren(2);
+  root->AddChild(0, 0, 0.5);
+  root->AddChild(1, 0, 0.5);
+  SearchNode* child = root->GetChild(1);
+  ASSERT_TRUE(child->IsInArena());
+  ASSERT_EQ(root.get(), child->GetParent());
+  ASSERT_EQ(oaz::arena::Arena::GetArena(child),
+            oaz::arena::Arena::GetArena(root.get()));
+}
+
+TEST(Arena, GrowChildren) {
+  auto root = SearchNode::CreateRoot(std::make_shared<oaz::arena::Arena>());
+  root->AddChild(0, 0, 0.5);
+  root->GetChild(0)->AddChild(0, 1, 1.);
+  for (size_t i = 1; i != 10; ++i) {
+    root->AddChild(i, 0, 0.5);
+  }
+  ASSERT_EQ(root->GetNChildren(), 10);
+  ASSERT_EQ(root->GetChild(0)->GetChild(0)->GetParent(), root->GetChild(0));
+  ASSERT_EQ(root->GetChild(9)->GetMove(), 9);
+}
+
+TEST(Arena, ClearChildren) {
+  auto arena = std::make_shared<oaz::arena::Arena>();
+  auto root = SearchNode::CreateRoot(arena);
+  size_t n_root_bytes = arena->GetNAllocatedBytes();
+  root->ReserveChildren(7);
+  for (size_t i = 0; i != 7; ++i) {
+    root->AddChild(i, 0, 1. / 7);
+  }
+  root->GetChild(3)->AddChild(0, 1, 1.);
+  root->ClearChildren();
+  ASSERT_TRUE(root->IsLeaf());
+  ASSERT_EQ(arena->GetNAllocatedBytes(), n_root_bytes);
+}
+
+TEST(Arena, PendingChildren) {
+  auto arena = std::make_shared<oaz::arena::Arena>();
+  auto root = SearchNode::CreateRoot(arena);
+  size_t n_root_bytes = arena->GetNAllocatedBytes();
+  root->SetPendingChildren({{0.5, 4}, {0.3, 2}, {0.2, 0}}, 1);
+  ASSERT_TRUE(root->IsLeaf());
+  ASSERT_EQ(root->GetNMoves(), 3);
+  ASSERT_EQ(root->GetChildMove(2), 0);
+
+  // Built children only count once published
+  root->BuildPendingChildren(2);
+  ASSERT_EQ(root->GetNChildren(), 0);
+  root->PublishChildren(2);
+  ASSERT_EQ(root->GetNChildren(), 2);
+  ASSERT_EQ(root->GetChild(1)->GetMove(), 2);
+  ASSERT_EQ(root->GetChild(1)->GetPlayer(), 1);
+  ASSERT_FLOAT_EQ(root->GetChild(1)->GetPrior(), 0.3);
+  ASSERT_EQ(root->GetChild(1)->GetParent(), root.get());
+  ASSERT_TRUE(root->GetChild(1)->IsInArena());
+  root->GetChild(0)->AddChild(0, 0, 1.);
+
+  SearchNode copy(*root);
+  ASSERT_EQ(copy.GetNChildren(), 2);
+  ASSERT_EQ(copy.GetNMoves(), 3);
+  ASSERT_EQ(copy.GetChildMove(2), 0);
+  ASSERT_EQ(copy.GetChild(0)->GetChild(0)->GetParent(), copy.GetChild(0));
+
+  root->ClearChildren();
+  ASSERT_FALSE(root->HasPendingChildren());
+  ASSERT_EQ(root->GetNMoves(), 0);
+  ASSERT_EQ(arena->GetNAllocatedBytes(), n_root_bytes);
+}
+
+TEST(Copy, Default) {
+  SearchNode root;
+  root.AddChild(0, 0, 0.5);
+  root.GetChild(0)->AddChild(1, 1, 1.);
+  SearchNode copy(root);
+  ASSERT_EQ(copy.GetNChildren(), 1);
+  ASSERT_EQ(copy.GetChild(0)->GetParent(), &copy);
+  ASSERT_EQ(copy.GetChild(0)->GetChild(0)->GetMove(), 1);
+}
+
+TEST(Layout, BytesPerNode) {
+  std::cout << "Bytes per SearchNode: " << sizeof(SearchNode) << std::endl;
+  ASSERT_LE(sizeof(SearchNode), 40);
+}
+
+TEST(ShardedStatistics, Merge) {
+  SearchNode node;
+  node.IncrementNVisits();
+  node.AddValue(0.5);
+  node.ShardStatistics(4);
+  ASSERT_TRUE(node.HasShardedStatistics());
+  ASSERT_EQ(node.GetNVisits(), 1);
+  ASSERT_FLOAT_EQ(node.GetAccumulatedValue(), 0.5);
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i != 4; ++i) {
+    threads.emplace_back([&node] {
+      for (size_t j = 0; j != 1000; ++j) {
+        node.IncrementNVisits();
+        node.AddValue(1.);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(node.GetNVisits(), 4001);
+  ASSERT_FLOAT_EQ(node.GetAccumulatedValue(), 4000.5);
+
+  SearchNode copy(node);
+  ASSERT_FALSE(copy.HasShardedStatistics());
+  ASSERT_EQ(copy.GetNVisits(), 4001);
+}
+
+namespace {
+class IncrementTask : public oaz::thread_pool::Task {
+ public:
+  IncrementTask() : m_node(nullptr), m_worker_index(0) {}
+  explicit IncrementTask(SearchNode* node)
+      : m_node(node), m_worker_index(0) {}
+  void operator()() override {
+    m_worker_index = oaz::thread_pool::ThreadPool::GetWorkerIndex();
+    m_node->IncrementNVisits();
+  }
+  size_t GetWorkerIndex() const { return m_worker_index; }
+
+ private:
+  SearchNode* m_node;
+  size_t m_worker_index;
+};
+}  // namespace
+
+TEST(ShardedStatistics, PoolWorkers) {
+  SearchNode node;
+  node.ShardStatistics(3);
+  std::vector<IncrementTask> tasks(100, IncrementTask(&node));
+  {
+    oaz::thread_pool::ThreadPool pool(2);
+    for (auto& task : tasks) {
+      pool.enqueue(&task);
+    }
+    // Threads outside of the pool share the last shard
+    node.IncrementNVisits();
+  }
+  ASSERT_EQ(node.GetNVisits(), 101);
+  for (const auto& task : tasks) {
+    ASSERT_LT(task.GetWorkerIndex(), 2);
+  }
+  ASSERT_EQ(oaz::thread_pool::ThreadPool::GetWorkerIndex(),
+            oaz::thread_pool::ThreadPool::NOT_A_WORKER);
+}
+
+TEST(ShardedStatistics, Arena) {
+  auto arena = std::make_shared<oaz::arena::Arena>();
+  auto root = SearchNode::CreateRoot(arena);
+  size_t n_root_bytes = arena->GetNAllocatedBytes();
+  root->AddChild(0, 0, 1.);
+  root->GetChild(0)->ShardStatistics(16);
+  root->GetChild(0)->IncrementNVisits();
+  ASSERT_EQ(root->GetChild(0)->GetNVisits(), 1);
+  root->ClearChildren();
+  ASSERT_EQ(arena->GetNAllocatedBytes(), n_root_bytes);
+}
+
+TEST(Alias, Default) {
+  SearchNode root;
+  root.AddChild(0, 0, 1.);
+  root.AddChild(1, 0, 1.);
+  SearchNode* target = root.GetChild(0);
+  target->AddChild(2, 1, 1.);
+  SearchNode* alias = root.GetChild(1);
+  alias->SetAliasTarget(target);
+  ASSERT_TRUE(alias->IsAlias());
+  ASSERT_TRUE(alias->IsLeaf());
+  ASSERT_EQ(alias->GetAliasTarget(), target);
+
+  // Freeing an alias leaves its target alone
+  alias->ClearChildren();
+  ASSERT_FALSE(alias->IsAlias());
+  ASSERT_EQ(target->GetNChildren(), 1);
+}
+
+TEST(Alias, Move) {
+  SearchNode target;
+  SearchNode alias;
+  alias.SetAliasTarget(&target);
+  SearchNode moved(std::move(alias));
+  ASSERT_TRUE(moved.IsAlias());
+  ASSERT_EQ(moved.GetAliasTarget(), &target);
+  ASSERT_FALSE(alias.IsAlias());
+}
+
+TEST(ProvenValue, Default) {
+  SearchNode root;
+  root.AddChild(0, 0, 1.);
+  root.AddChild(1, 0, 1.);
+  SearchNode* child = root.GetChild(0);
+  ASSERT_FALSE(child->IsProven());
+  ASSERT_TRUE(child->SetProvenValue(ProvenValue::WIN));
+  ASSERT_EQ(child->GetProvenValue(), ProvenValue::WIN);
+  // Proven values never change
+  ASSERT_FALSE(child->SetProvenValue(ProvenValue::LOSS));
+  ASSERT_EQ(child->GetProvenValue(), ProvenValue::WIN);
+
+  // An alias has the proven value of its target
+  SearchNode* alias = root.GetChild(1);
+  alias->SetAliasTarget(child);
+  ASSERT_EQ(alias->GetProvenValue(), ProvenValue::WIN);
+
+  SearchNode moved(std::move(*child));
+  ASSERT_EQ(moved.GetProvenValue(), ProvenValue::WIN);
+}
@@ -0,0 +1,41 @@
+#include "oaz/mcts/time_allocation.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace oaz::mcts;
+
+TEST(TimeAllocator, EqualShares) {
+  TimeAllocator allocator(10., 20);
+  ASSERT_DOUBLE_EQ(allocator.GetMoveBudget(), 0.5);
+  allocator.ConsumeTime(0.5);
+  ASSERT_DOUBLE_EQ(allocator.GetRemainingTime(), 9.5);
+  ASSERT_EQ(allocator.GetNMovesPlayed(), 1);
+  ASSERT_DOUBLE_EQ(allocator.GetMoveBudget(), 0.5);
+}
+
+TEST(TimeAllocator, LongGame) {
+  TimeAllocator allocator(10., 5);
+  for (size_t i = 0; i != 100; ++i) {
+    double budget = allocator.GetMoveBudget();
+    ASSERT_GT(budget, 0.);
+    ASSERT_LE(budget, 0.5 * allocator.GetRemainingTime());
+    allocator.ConsumeTime(budget);
+  }
+  ASSERT_GT(allocator.GetRemainingTime(), 0.);
+}
+
+TEST(TimeAllocator, Increment) {
+  TimeAllocator allocator(10., 20, 1.);
+  ASSERT_DOUBLE_EQ(allocator.GetMoveBudget(), 1.5);
+  allocator.ConsumeTime(1.5);
+  ASSERT_DOUBLE_EQ(allocator.GetRemainingTime(), 9.5);
+}
+
+TEST(TimeAllocator, Reset) {
+  TimeAllocator allocator(10., 20);
+  allocator.ConsumeTime(3.);
+  allocator.Reset();
+  ASSERT_DOUBLE_EQ(allocator.GetRemainingTime(), 10.);
+  ASSERT_EQ(allocator.GetNMovesPlayed(), 0);
+}
@@ -54,6 +54,19 @@ TEST(EvaluationBatch, AcquireIndex) {
   ASSERT_FLOAT_EQ(index, 1);
 }
 
+TEST(EvaluationBatch, AcquireIndices) {
+  EvaluationBatch batch({6, 7, 2}, 8);
+
+  size_t index = 0;
+  ASSERT_EQ(batch.AcquireIndices(5, &index), 5);
+  ASSERT_EQ(index, 0);
+  ASSERT_FALSE(batch.IsFull());
+
+  ASSERT_EQ(batch.AcquireIndices(5, &index), 3);
+  ASSERT_EQ(index, 5);
+  ASSERT_TRUE(batch.IsFull());
+}
+
 TEST(NNEvaluator, Instantiation) {
   auto pool = std::make_shared<oaz::thread_pool::ThreadPool>(1);
   std::unique_ptr<tensorflow::Session> session(
@@ -79,6 +92,43 @@ TEST(NNEvaluator, RequestEvaluation) {
   task.wait();
 }
 
+TEST(NNEvaluator, RequestEvaluations) {
+  std::unique_ptr<tensorflow::Session> session(
+      CreateSessionAndLoadGraph("frozen_model.pb"));
+  auto model = CreateModel(session.get(), "input", "value", "policy");
+  auto pool = std::make_shared<oaz::thread_pool::ThreadPool>(1);
+  auto cache =
+      std::make_shared<oaz::cache::SimpleCache>(oaz::games::ConnectFour(), 100);
+  NNEvaluator evaluator(model, cache, pool, {6, 7, 2}, 8);
+
+  size_t N_REQUESTS = 20;
+  oaz::games::ConnectFour game;
+  std::vector<std::unique_ptr<oaz::evaluator::Evaluation>> evaluations(
+      N_REQUESTS);
+  oaz::thread_pool::DummyTask task(N_REQUESTS);
+
+  std::vector<oaz::games::Game*> games(N_REQUESTS, &game);
+  std::vector<std::unique_ptr<oaz::evaluator::Evaluation>*> evaluation_ptrs;
+  for (auto& evaluation : evaluations) {
+    evaluation_ptrs.push_back(&evaluation);
+  }
+  std::vector<oaz::thread_pool::Task*> tasks(N_REQUESTS, &task);
+
+  evaluator.RequestEvaluations(games, evaluation_ptrs, tasks);
+  task.wait();
+
+  for (auto& evaluation : evaluations) {
+    ASSERT_NE(evaluation, nullptr);
+  }
+
+  oaz::thread_pool::DummyTask cached_task(N_REQUESTS);
+  std::vector<oaz::thread_pool::Task*> cached_tasks(N_REQUESTS, &cached_task);
+  evaluator.RequestEvaluations(games, evaluation_ptrs, cached_tasks);
+  cached_task.wait();
+
+  ASSERT_EQ(cache->GetNumberOfHits(), N_REQUESTS);
+}
+
 TEST(NNEvaluator, EvaluationWithCache) {
   std::unique_ptr<tensorflow::Session> session(
       CreateSessionAndLoadGraph("frozen_model.pb"));
@@ -0,0 +1,77 @@
+#include "oaz/reclaimer/reclaimer.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace oaz::reclaimer;
+using namespace testing;
+
+namespace {
+class Tracked {
+ public:
+  explicit Tracked(std::thread::id* destruction_thread)
+      : m_destruction_thread(destruction_thread) {}
+  ~Tracked() { *m_destruction_thread = std::this_thread::get_id(); }
+  Tracked(const Tracked&) = delete;
+  Tracked(Tracked&&) = delete;
+  Tracked& operator=(const Tracked&) = delete;
+  Tracked& operator=(Tracked&&) = delete;
+
+ private:
+  std::thread::id* m_destruction_thread;
+};
+}  // namespace
+
+TEST(Reclaimer, Instantiation) { Reclaimer reclaimer; }
+
+TEST(Reclaimer, JobsRunInOrder) {
+  Reclaimer reclaimer;
+  std::vector<int> order;
+  for (int i = 0; i != 100; ++i) {
+    reclaimer.Defer([&order, i] { order.push_back(i); });
+  }
+  reclaimer.Wait();
+  ASSERT_EQ(reclaimer.GetNPendingJobs(), 0);
+  ASSERT_EQ(order.size(), 100);
+  for (int i = 0; i != 100; ++i) {
+    ASSERT_EQ(order[i], i);
+  }
+}
+
+TEST(Reclaimer, Release) {
+  Reclaimer reclaimer;
+  std::thread::id destruction_thread;
+  auto tracked = std::make_shared<Tracked>(&destruction_thread);
+  reclaimer.Release(std::move(tracked));
+  reclaimer.Wait();
+  ASSERT_NE(destruction_thread, std::thread::id());
+  ASSERT_NE(destruction_thread, std::this_thread::get_id());
+}
+
+TEST(Reclaimer, ReleaseSharedObject) {
+  Reclaimer reclaimer;
+  std::thread::id destruction_thread;
+  auto tracked = std::make_shared<Tracked>(&destruction_thread);
+  reclaimer.Release(tracked);
+  reclaimer.Wait();
+  // Another reference was left: the object outlives the release
+  ASSERT_EQ(destruction_thread, std::thread::id());
+  tracked.reset();
+  ASSERT_EQ(destruction_thread, std::this_thread::get_id());
+}
+
+TEST(Reclaimer, DestructorRunsPendingJobs) {
+  std::atomic<int> n_jobs(0);
+  {
+    Reclaimer reclaimer;
+    for (int i = 0; i != 100; ++i) {
+      reclaimer.Defer([&n_jobs] { ++n_jobs; });
+    }
+  }
+  ASSERT_EQ(n_jobs, 100);
+}
@@ -0,0 +1,258 @@
+#include "oaz/self_play/self_play.hpp"
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "oaz/games/tic_tac_toe.hpp"
+#include "oaz/mcts/selection.hpp"
+#include "oaz/simulation/simulation_evaluator.hpp"
+
+using namespace std;
+using namespace oaz::self_play;
+using namespace oaz::mcts;
+using namespace oaz::games;
+
+namespace {
+/* Tic-tac-toe game that cannot be cloned, to make self-play throw */
+class UnclonableTicTacToe : public Game {
+ public:
+  const Class& ClassMethods() const override { return m_game.ClassMethods(); }
+  void PlayFromString(std::string moves) override {
+    m_game.PlayFromString(moves);
+  }
+  void PlayMove(size_t move) override { m_game.PlayMove(move); }
+  void UndoMove(size_t move) override { m_game.UndoMove(move); }
+  void GetAvailableMoves(std::vector<size_t>* moves) const override {
+    m_game.GetAvailableMoves(moves);
+  }
+  float GetScore() const override { return m_game.GetScore(); }
+  size_t GetCurrentPlayer() const override {
+    return m_game.GetCurrentPlayer();
+  }
+  bool IsFinished() const override { return m_game.IsFinished(); }
+  void WriteStateToTensorMemory(float* destination) const override {
+    m_game.WriteStateToTensorMemory(destination);
+  }
+  void WriteCanonicalStateToTensorMemory(float* destination) const override {
+    m_game.WriteCanonicalStateToTensorMemory(destination);
+  }
+  void InitialiseFromState(float* state) override {
+    m_game.InitialiseFromState(state);
+  }
+  void InitialiseFromCanonicalState(float* state) override {
+    m_game.InitialiseFromCanonicalState(state);
+  }
+  std::unique_ptr<Game> Clone() const override {
+    throw std::runtime_error("Cannot clone");
+  }
+  void CopyFrom(const Game&) override {
+    throw std::runtime_error("Cannot copy");
+  }
+
+ private:
+  TicTacToe m_game;
+};
+
+std::vector<PlayerSearchProperties> CreatePlayerSearchProperties(
+    std::shared_ptr<oaz::thread_pool::ThreadPool> pool) {
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<UCTSelector>();
+  return {PlayerSearchProperties(evaluator, selector),
+          PlayerSearchProperties(evaluator, selector)};
+}
+
+SelfPlayOptions CreateOptions() {
+  SelfPlayOptions options;
+  options.n_concurrent_games = 4;
+  options.search_options.batch_size = 2;
+  options.search_options.n_iterations = 50;
+  return options;
+}
+}  // namespace
+
+TEST(SelfPlay, Dataset) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  SelfPlay self_play(CreatePlayerSearchProperties(pool), pool,
+                     CreateOptions());
+  TicTacToe game;
+  size_t n_games = 10;
+  self_play.Play(game, n_games);
+
+  size_t n_positions = self_play.GetNPositions();
+  ASSERT_EQ(self_play.GetBoardSize(), 18);
+  ASSERT_EQ(self_play.GetPolicySize(), 9);
+  ASSERT_EQ(self_play.GetBoards().size(), n_positions * 18);
+  ASSERT_EQ(self_play.GetPolicies().size(), n_positions * 9);
+  // Each game has between 5 and 9 moves, and its final position is recorded
+  ASSERT_GE(n_positions, n_games * 6);
+  ASSERT_LE(n_positions, n_games * 10);
+
+  size_t n_starting_positions = 0;
+  for (size_t i = 0; i != n_positions; ++i) {
+    float total_probability = 0.;
+    for (size_t j = 0; j != 9; ++j) {
+      total_probability += self_play.GetPolicies()[i * 9 + j];
+    }
+    ASSERT_NEAR(total_probability, 1., 1e-5);
+
+    float n_stones = 0.;
+    for (size_t j = 0; j != 18; ++j) {
+      n_stones += self_play.GetBoards()[i * 18 + j];
+    }
+    if (n_stones == 0.) {
+      ++n_starting_positions;
+    }
+
+    float value = self_play.GetValues()[i];
+    ASSERT_TRUE(value == 1. || value == 0. || value == -1.);
+  }
+  ASSERT_EQ(n_starting_positions, n_games);
+
+  self_play.Clear();
+  ASSERT_EQ(self_play.GetNPositions(), 0);
+}
+
+TEST(SelfPlay, StartingPositions) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  SelfPlayOptions options = CreateOptions();
+  options.temperature = 0.;
+  options.discount_factor = 0.5;
+  SelfPlay self_play(CreatePlayerSearchProperties(pool), pool, options);
+
+  // Player 0 wins at once by playing 2
+  TicTacToe game;
+  game.PlayFromString("0314");
+  std::vector<const Game*> games = {&game, &game};
+  self_play.Play(games);
+
+  ASSERT_EQ(self_play.GetNPositions(), 4);
+  for (size_t i = 0; i != 2; ++i) {
+    ASSERT_GT(self_play.GetPolicies()[2 * i * 9 + 2], 0.5);
+    ASSERT_FLOAT_EQ(self_play.GetValues()[2 * i], 0.5);
+    // Player 1 is to move in the final position, which player 0 won
+    ASSERT_FLOAT_EQ(self_play.GetValues()[2 * i + 1], -1.);
+  }
+}
+
+TEST(SelfPlay, FinishedStartingPositions) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  SelfPlay self_play(CreatePlayerSearchProperties(pool), pool,
+                     CreateOptions());
+
+  // Player 0 has already won: only the final position is recorded
+  TicTacToe finished_game;
+  finished_game.PlayFromString("03142");
+  TicTacToe game;
+  game.PlayFromString("0314");
+  std::vector<const Game*> games = {&finished_game, &game, &finished_game,
+                                    &finished_game, &finished_game,
+                                    &finished_game};
+  self_play.Play(games);
+  ASSERT_GE(self_play.GetNPositions(), 5 + 2);
+  size_t n_finished_positions = 0;
+  for (size_t i = 0; i != self_play.GetNPositions(); ++i) {
+    if (self_play.GetValues()[i] == -1.) {
+      ++n_finished_positions;
+    }
+  }
+  ASSERT_GE(n_finished_positions, 5);
+
+  self_play.Clear();
+  std::vector<const Game*> finished_games = {&finished_game, &finished_game};
+  self_play.Play(finished_games);
+  ASSERT_EQ(self_play.GetNPositions(), 2);
+  ASSERT_FLOAT_EQ(self_play.GetValues()[0], -1.);
+}
+
+TEST(SelfPlay, Exception) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  SelfPlayOptions options = CreateOptions();
+  options.search_options.n_iterations = 1000;
+  SelfPlay self_play(CreatePlayerSearchProperties(pool), pool, options);
+
+  // The searches of the first games are still running when starting the
+  // last one throws: they must be done before the queue goes away
+  TicTacToe game;
+  UnclonableTicTacToe unclonable_game;
+  std::vector<const Game*> games = {&game, &game, &game, &unclonable_game};
+  ASSERT_THROW(self_play.Play(games), std::runtime_error);
+  ASSERT_EQ(self_play.GetNPositions(), 0);
+
+  self_play.Play(game, 1);
+  ASSERT_GT(self_play.GetNPositions(), 0);
+}
+
+TEST(SelfPlay, GumbelRoot) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  auto evaluator = make_shared<oaz::simulation::SimulationEvaluator>(pool);
+  std::shared_ptr<Selector> selector = std::make_shared<GumbelSelector>(4);
+  std::vector<PlayerSearchProperties> player_search_properties = {
+      PlayerSearchProperties(evaluator, selector),
+      PlayerSearchProperties(evaluator, selector)};
+  SelfPlayOptions options = CreateOptions();
+  options.search_options.n_iterations = 16;
+  SelfPlay self_play(player_search_properties, pool, options);
+  TicTacToe game;
+  size_t n_games = 10;
+  self_play.Play(game, n_games);
+
+  // Improved policies are recorded rather than visit counts
+  size_t n_positions = self_play.GetNPositions();
+  ASSERT_GE(n_positions, n_games * 6);
+  ASSERT_LE(n_positions, n_games * 10);
+  for (size_t i = 0; i != n_positions; ++i) {
+    float total_probability = 0.;
+    for (size_t j = 0; j != 9; ++j) {
+      total_probability += self_play.GetPolicies()[i * 9 + j];
+    }
+    ASSERT_NEAR(total_probability, 1., 1e-5);
+  }
+}
+
+TEST(SelfPlay, FoldSymmetries) {
+  auto pool = make_shared<oaz::thread_pool::ThreadPool>(2);
+  SelfPlayOptions options = CreateOptions();
+  options.search_options.fold_symmetries = true;
+  SelfPlay self_play(CreatePlayerSearchProperties(pool), pool, options);
+  TicTacToe game;
+  size_t n_games = 40;
+  self_play.Play(game, n_games);
+
+  // The policies of the starting positions give mirror moves the same
+  // probability, and the moves of both sides of the board are played
+  size_t n_starting_positions = 0;
+  std::vector<size_t> n_first_moves_by_column(3, 0);
+  for (size_t i = 0; i != self_play.GetNPositions(); ++i) {
+    float n_stones = 0.;
+    for (size_t j = 0; j != 18; ++j) {
+      n_stones += self_play.GetBoards()[i * 18 + j];
+    }
+    if (n_stones != 0.) {
+      continue;
+    }
+    ++n_starting_positions;
+    const float* policy = self_play.GetPolicies().data() + i * 9;
+    float total_probability = 0.;
+    for (size_t move = 0; move != 9; ++move) {
+      ASSERT_FLOAT_EQ(policy[move], policy[game.GetMirrorMove(move)]);
+      total_probability += policy[move];
+    }
+    ASSERT_NEAR(total_probability, 1., 1e-5);
+
+    // The board of the next position holds the first move
+    const float* board = self_play.GetBoards().data() + (i + 1) * 18;
+    for (size_t j = 0; j != 18; ++j) {
+      if (board[j] != 0.) {
+        ++n_first_moves_by_column[(j / 2) % 3];
+      }
+    }
+  }
+  ASSERT_EQ(n_starting_positions, n_games);
+  ASSERT_GT(n_first_moves_by_column[0], 0);
+  ASSERT_GT(n_first_moves_by_column[2], 0);
+}
@@ -1,6 +1,7 @@
 #include "oaz/games/tic_tac_toe.hpp"
 
 #include <algorithm>
+#include <random>
 #include <string>
 
 #include "gmock/gmock.h"
@@ -301,3 +302,45 @@ TEST(GameMap, InsertAlreadyInDB) {
   game_map->Insert(game, 1ll);
   ASSERT_EQ(game_map->GetSize(), 1);
 }
+
+TEST(UndoMove, RandomGames) {
+  std::mt19937 generator(0);
+  std::vector<size_t> available_moves;
+  for (size_t i = 0; i != 100; ++i) {
+    TicTacToe game;
+    std::vector<TicTacToe> positions;
+    std::vector<size_t> moves;
+    while (!game.IsFinished()) {
+      positions.push_back(game);
+      game.GetAvailableMoves(&available_moves);
+      std::uniform_int_distribution<size_t> distribution(
+          0, available_moves.size() - 1);
+      size_t move = available_moves[distribution(generator)];
+      game.PlayMove(move);
+      moves.push_back(move);
+    }
+    while (!moves.empty()) {
+      game.UndoMove(moves.back());
+      moves.pop_back();
+      ASSERT_TRUE(game == positions.back());
+      positions.pop_back();
+    }
+  }
+}
+
+TEST(MirrorSymmetry, Default) {
+  TicTacToe game;
+  ASSERT_TRUE(game.IsMirrorSymmetric());
+  ASSERT_EQ(game.GetMirrorMove(0), 6);
+  ASSERT_EQ(game.GetMirrorMove(5), 5);
+  ASSERT_EQ(game.GetMirrorMove(7), 1);
+  game.PlayMove(4);
+  ASSERT_TRUE(game.IsMirrorSymmetric());
+  game.PlayMove(0);
+  ASSERT_FALSE(game.IsMirrorSymmetric());
+  game.PlayMove(2);
+  ASSERT_FALSE(game.IsMirrorSymmetric());
+  game.PlayMove(6);
+  game.PlayMove(8);
+  ASSERT_TRUE(game.IsMirrorSymmetric());
+}